@@ -0,0 +1,234 @@
+#pragma once
+#ifndef ASYNC_CACHE_INCLUDED
+#define ASYNC_CACHE_INCLUDED
+
+#include <unordered_map>
+#include <list>
+#include <optional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include "./promise.h"
+#include "./executor.h"
+#include "./utils/fanout.h"
+#include "./utils/detached.h"
+
+namespace pro
+{
+	/*
+	Cache of promised values. A hit on a settled entry returns an already settled promise,
+	a hit on a pending entry joins the load in flight, a miss submits the loader to the executor.
+	Entries are spread over independently locked shards, each one evicting its least
+	recently used entry when full.
+	*/
+	template<typename K, typename V, typename Hash = std::hash<K>, typename = std::enable_if_t<!std::is_void<V>::value>>
+	class async_cache
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+		using loader_type = std::function<promise<V>(const K&)>;
+
+		struct options {
+			size_t capacity = 1024;
+			size_t shards = 16;
+			clock::duration ttl = clock::duration::max();
+			//how long typed rejections are remembered, zero - not at all
+			clock::duration negative_ttl = clock::duration::zero();
+			//runs the loader, executor::shared() when not set
+			executor* ex = nullptr;
+		};
+
+		struct counters {
+			unsigned long long hits;
+			unsigned long long misses;
+			unsigned long long coalesced;
+			unsigned long long evictions;
+		};
+
+		async_cache(loader_type loader, options opts = {})
+			: state(std::make_shared<_state>(std::move(loader), opts)) {}
+
+		promise<V> get(const K& key) {
+			_shard& shard = state->shard_for(key);
+			std::shared_ptr<detail::_fanout<V>> load;
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				auto it = shard.entries.find(key);
+
+				if (it != shard.entries.end() && it->second.expires <= clock::now()) {
+					shard.lru.erase(it->second.lru_position);
+					shard.entries.erase(it);
+					it = shard.entries.end();
+				}
+
+				if (it != shard.entries.end()) {
+					_entry& entry = it->second;
+					shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru_position);
+
+					if (entry.pending) {
+						++state->coalesced;
+						return entry.pending->subscribe();
+					}
+
+					++state->hits;
+					if (entry.rejection)
+						return promise<V>(entry.rejection);
+					return promise<V>(*entry.value);
+				}
+
+				++state->misses;
+				load = std::make_shared<detail::_fanout<V>>();
+				shard.lru.push_front(key);
+				shard.entries.emplace(key, _entry{ load, std::nullopt, nullptr, clock::time_point::max(), shard.lru.begin() });
+				state->evict(shard);
+			}
+
+			promise<V> subscription = load->subscribe();
+			_start(key, load);
+			return subscription;
+		}
+
+		void invalidate(const K& key) {
+			_shard& shard = state->shard_for(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+
+			auto it = shard.entries.find(key);
+			if (it != shard.entries.end()) {
+				shard.lru.erase(it->second.lru_position);
+				shard.entries.erase(it);
+			}
+		}
+
+		size_t size() const {
+			size_t total = 0;
+			for (auto& shard : state->shards) {
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				total += shard.entries.size();
+			}
+			return total;
+		}
+
+		counters stats() const {
+			return counters{ state->hits.load(), state->misses.load(), state->coalesced.load(), state->evictions.load() };
+		}
+
+	private:
+		struct _entry {
+			std::shared_ptr<detail::_fanout<V>> pending;
+			std::optional<V> value;
+			std::exception_ptr rejection;
+			clock::time_point expires;
+			typename std::list<K>::iterator lru_position;
+		};
+
+		struct _shard {
+			std::mutex mutex;
+			std::unordered_map<K, _entry, Hash> entries;
+			std::list<K> lru;
+		};
+
+		struct _state {
+			_state(loader_type loader, const options& opts)
+				: loader(std::move(loader)),
+				ex(opts.ex ? *opts.ex : executor::shared()),
+				ttl(opts.ttl),
+				negative_ttl(opts.negative_ttl),
+				shards(std::max<size_t>(1, opts.shards)),
+				shard_capacity(std::max<size_t>(1, (opts.capacity + shards.size() - 1) / shards.size())),
+				hits(0), misses(0), coalesced(0), evictions(0) {}
+
+			_shard& shard_for(const K& key) {
+				return shards[Hash()(key) % shards.size()];
+			}
+
+			void evict(_shard& shard) {
+				while (shard.entries.size() > shard_capacity) {
+					shard.entries.erase(shard.lru.back());
+					shard.lru.pop_back();
+					++evictions;
+				}
+			}
+
+			//stores the outcome, unless the entry was invalidated or evicted in the meantime
+			template<typename Settle>
+			void settle(const K& key, const std::shared_ptr<detail::_fanout<V>>& load, Settle&& settle_entry) {
+				_shard& shard = shard_for(key);
+				std::lock_guard<std::mutex> lock(shard.mutex);
+
+				auto it = shard.entries.find(key);
+				if (it == shard.entries.end() || it->second.pending != load)
+					return;
+
+				it->second.pending.reset();
+				if (false == settle_entry(it->second)) {
+					shard.lru.erase(it->second.lru_position);
+					shard.entries.erase(it);
+				}
+			}
+
+			promise<V> load(const K& key) {
+				try {
+					return loader(key);
+				}
+				catch (...) {
+					return promise<V>(std::current_exception());
+				}
+			}
+
+			static clock::time_point expiry(clock::duration ttl) {
+				auto now = clock::now();
+				return ttl >= clock::time_point::max() - now ? clock::time_point::max() : now + ttl;
+			}
+
+			loader_type loader;
+			executor& ex;
+			const clock::duration ttl;
+			const clock::duration negative_ttl;
+			std::vector<_shard> shards;
+			const size_t shard_capacity;
+
+			std::atomic<unsigned long long> hits;
+			std::atomic<unsigned long long> misses;
+			std::atomic<unsigned long long> coalesced;
+			std::atomic<unsigned long long> evictions;
+		};
+
+		void _start(const K& key, std::shared_ptr<detail::_fanout<V>> load) {
+			auto owner = state;
+			owner->ex.submit([owner, key, load] {
+				_settle(owner, key, load, owner->load(key));
+			});
+		}
+
+		static void _settle(std::shared_ptr<_state> owner, const K& key, std::shared_ptr<detail::_fanout<V>> load, promise<V>&& loading) {
+			detail::_settle_detached(std::move(loading),
+				[owner, key, load](V value) {
+					owner->settle(key, load, [&owner, &value](_entry& entry) {
+						entry.value = value;
+						entry.expires = _state::expiry(owner->ttl);
+						return true;
+					});
+					load->resolve(value);
+				},
+				[owner, key, load](V rejection) {
+					std::exception_ptr eptr = std::make_exception_ptr(rejection);
+					owner->settle(key, load, [&owner, &eptr](_entry& entry) {
+						if (owner->negative_ttl <= clock::duration::zero())
+							return false;
+						entry.rejection = eptr;
+						entry.expires = _state::expiry(owner->negative_ttl);
+						return true;
+					});
+					load->reject(eptr);
+				},
+				[owner, key, load](std::exception_ptr eptr) {
+					owner->settle(key, load, [](_entry&) { return false; });
+					load->reject(eptr);
+				});
+		}
+
+		std::shared_ptr<_state> state;
+	};
+}
+
+#endif //ASYNC_CACHE_INCLUDED
\ No newline at end of file
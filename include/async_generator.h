@@ -0,0 +1,214 @@
+#pragma once
+#ifndef ASYNC_GENERATOR_INCLUDED
+#define ASYNC_GENERATOR_INCLUDED
+
+#include <optional>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "./promise.h"
+
+namespace pro
+{
+	//thrown out of yield() once nobody consumes the generator, a producer must let it through
+	class generator_stopped : public std::exception {
+	public:
+		const char* what() const noexcept override {
+			return "Generator is stopped";
+		}
+	};
+
+	namespace detail
+	{
+		template<typename T>
+		class _generator_state : public std::enable_shared_from_this<_generator_state<T>>
+		{
+		public:
+			//handed to the producer, each call waits for a pending request and settles it
+			class yielder
+			{
+			public:
+				void operator()(T value) {
+					state._yield(std::move(value));
+				}
+
+				//true once the generator is gone, the next call would throw generator_stopped
+				bool stop_requested() const {
+					std::lock_guard<std::mutex> lock(state.mutex);
+					return state.cancelled;
+				}
+
+			private:
+				friend class _generator_state<T>;
+
+				explicit yielder(_generator_state<T>& state) : state(state) {}
+
+				_generator_state<T>& state;
+			};
+
+			using producer_type = std::function<void(yielder&)>;
+
+			explicit _generator_state(producer_type producer)
+				: producer(std::move(producer)), started(false), done(false), cancelled(false) {
+			}
+
+			//settled by the producer thread with the next value, empty once it returned
+			std::future<std::optional<T>> request() {
+				std::promise<std::optional<T>> request;
+				std::future<std::optional<T>> result = request.get_future();
+
+				std::unique_lock<std::mutex> lock(mutex);
+				if (done) {
+					std::exception_ptr failure = eptr;
+					lock.unlock();
+					_end(request, failure);
+					return result;
+				}
+
+				requests.push_back(std::move(request));
+				if (false == started) {
+					started = true;
+					std::thread t(&_generator_state<T>::_produce, this->shared_from_this());
+					t.detach();
+				}
+				else {
+					cv.notify_all();
+				}
+				return result;
+			}
+
+			//next value, or an empty optional once the producer returned; rethrows its failure
+			std::optional<T> pull() {
+				return request().get();
+			}
+
+			void cancel() {
+				std::lock_guard<std::mutex> lock(mutex);
+				cancelled = true;
+				cv.notify_all();
+			}
+
+		private:
+			void _yield(T value) {
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [this] { return false == requests.empty() || cancelled; });
+				if (cancelled)
+					throw generator_stopped();
+
+				std::promise<std::optional<T>> request = std::move(requests.front());
+				requests.pop_front();
+				lock.unlock();
+				request.set_value(std::optional<T>(std::move(value)));
+			}
+
+			void _produce() {
+				yielder yield(*this);
+				std::exception_ptr failure;
+				try {
+					producer(yield);
+				}
+				catch (generator_stopped&) {
+				}
+				catch (...) {
+					failure = std::current_exception();
+				}
+
+				std::deque<std::promise<std::optional<T>>> pending;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					done = true;
+					eptr = failure;
+					pending.swap(requests);
+				}
+				for (auto& request : pending)
+					_end(request, failure);
+			}
+
+			static void _end(std::promise<std::optional<T>>& request, const std::exception_ptr& failure) {
+				if (failure)
+					request.set_exception(failure);
+				else
+					request.set_value(std::nullopt);
+			}
+
+			producer_type producer;
+
+			mutable std::mutex mutex;
+			std::condition_variable cv;
+			bool started;
+			std::deque<std::promise<std::optional<T>>> requests;
+			bool done;
+			bool cancelled;
+			std::exception_ptr eptr;
+		};
+	}
+
+	/*
+	Stream of values produced on demand. The producer runs on one thread of its own once
+	the first value is asked for, and each yield waits for a pending next() and settles
+	its promise directly. The producer fails the stream by throwing - a thrown T is a
+	rejection, anything else an exception, like in promise<T>. A generator has a single
+	consumer; when every handle of it is gone, yield throws generator_stopped, which the
+	producer must not swallow - yield.stop_requested() lets it stop without the throw.
+	*/
+	template<typename T>
+	class async_generator
+	{
+	public:
+		using yielder = typename detail::_generator_state<T>::yielder;
+
+		template<typename Function, typename = std::enable_if_t<std::is_invocable_v<Function&, yielder&>>>
+		explicit async_generator(Function&& producer)
+			: state(std::make_shared<detail::_generator_state<T>>(std::forward<Function>(producer))),
+			consumer(std::shared_ptr<void>(nullptr, [state = state](void*) { state->cancel(); })) {
+		}
+
+		async_generator(async_generator&&) = default;
+		async_generator& operator=(async_generator&&) = default;
+		async_generator(const async_generator&) = delete;
+		async_generator& operator=(const async_generator&) = delete;
+
+		//fulfills with the next value, or an empty optional at the end of the stream
+		promise<std::optional<T>> next() {
+			return promise<std::optional<T>>(state->request());
+		}
+
+		//fulfills when the stream ended, rejects as the producer or the callback failed
+		template<typename Cb, typename = std::enable_if_t<std::is_invocable_v<Cb, T>>>
+		promise<void> for_each(Cb&& callback) {
+			return promise<void>([state = state, consumer = consumer, callback]() mutable {
+				while (std::optional<T> value = state->pull())
+					callback(std::move(*value));
+			});
+		}
+
+		template<typename Cb, typename RCb, typename ExCb,
+			typename = std::enable_if_t<std::is_invocable_v<Cb, T>>,
+			typename = std::enable_if_t<std::is_invocable_v<RCb, T>>,
+			typename = std::enable_if_t<std::is_invocable_v<ExCb, std::exception_ptr>>>
+		promise<void> for_each(Cb&& callback, RCb&& rejectCallback, ExCb&& exceptionCallback) {
+			return promise<void>([state = state, consumer = consumer, callback, rejectCallback, exceptionCallback]() mutable {
+				try {
+					while (std::optional<T> value = state->pull())
+						callback(std::move(*value));
+				}
+				catch (T& ex) {
+					rejectCallback(std::move(ex));
+				}
+				catch (...) {
+					exceptionCallback(std::current_exception());
+				}
+			});
+		}
+
+	private:
+		std::shared_ptr<detail::_generator_state<T>> state;
+		//copied into every consumer, the last one gone cancels the producer
+		std::shared_ptr<void> consumer;
+	};
+}
+
+#endif //ASYNC_GENERATOR_INCLUDED
\ No newline at end of file
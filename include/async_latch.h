@@ -0,0 +1,238 @@
+#pragma once
+#ifndef ASYNC_LATCH_INCLUDED
+#define ASYNC_LATCH_INCLUDED
+
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include "./promise.h"
+
+namespace pro
+{
+	namespace detail
+	{
+		//waiters released together, swapped out under the lock and settled outside it
+		class _waiter_list
+		{
+		public:
+			promise<void> add() {
+				std::promise<void> waiter;
+				promise<void> result(waiter.get_future());
+				waiters.push_back(std::move(waiter));
+				return result;
+			}
+
+			std::deque<std::promise<void>> take() {
+				std::deque<std::promise<void>> taken;
+				taken.swap(waiters);
+				return taken;
+			}
+
+			std::promise<void> take_first() {
+				std::promise<void> first = std::move(waiters.front());
+				waiters.pop_front();
+				return first;
+			}
+
+			bool empty() const {
+				return waiters.empty();
+			}
+
+			size_t size() const {
+				return waiters.size();
+			}
+
+			static void release(std::deque<std::promise<void>>& released) {
+				for (auto& waiter : released)
+					waiter.set_value();
+			}
+
+			static promise<void> ready() {
+				std::promise<void> resolver;
+				resolver.set_value();
+				return promise<void>(resolver.get_future());
+			}
+
+		private:
+			std::deque<std::promise<void>> waiters;
+		};
+	}
+
+	/*
+	Single-use countdown. Counting down is one atomic decrement, only the arrival
+	reaching zero takes the lock to release every waiter at once.
+	*/
+	class async_latch
+	{
+	public:
+		explicit async_latch(ptrdiff_t expected) : counter(expected), released(expected <= 0) {}
+
+		async_latch(const async_latch&) = delete;
+		async_latch& operator=(const async_latch&) = delete;
+
+		void count_down(ptrdiff_t n = 1) {
+			ptrdiff_t before = counter.fetch_sub(n, std::memory_order_acq_rel);
+			if (before > 0 && before - n <= 0)
+				_release();
+		}
+
+		promise<void> wait() {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (released)
+				return detail::_waiter_list::ready();
+			return waiters.add();
+		}
+
+		promise<void> arrive_and_wait(ptrdiff_t n = 1) {
+			count_down(n);
+			return wait();
+		}
+
+		bool try_wait() const {
+			return counter.load(std::memory_order_acquire) <= 0;
+		}
+
+	private:
+		void _release() {
+			std::deque<std::promise<void>> waiting;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				released = true;
+				waiting = waiters.take();
+			}
+			detail::_waiter_list::release(waiting);
+		}
+
+		std::atomic<ptrdiff_t> counter;
+		std::mutex mutex;
+		bool released;
+		detail::_waiter_list waiters;
+	};
+
+	/*
+	Reusable barrier for a fixed number of participants. The last arrival of a phase
+	runs the completion function, then starts the next phase and releases the waiters.
+	The completion runs under the barrier's lock, so it must not call back into it.
+	*/
+	class async_barrier
+	{
+	public:
+		using completion_type = std::function<void()>;
+
+		explicit async_barrier(ptrdiff_t participants, completion_type completion = nullptr)
+			: participants(participants), remaining(participants), phase(0), completion(std::move(completion)) {
+		}
+
+		async_barrier(const async_barrier&) = delete;
+		async_barrier& operator=(const async_barrier&) = delete;
+
+		//fulfills when every participant arrived in this phase
+		promise<void> arrive() {
+			std::unique_lock<std::mutex> lock(mutex);
+			promise<void> result = waiters.add();
+			if (--remaining > 0)
+				return result;
+
+			std::deque<std::promise<void>> waiting = _next_phase();
+			lock.unlock();
+			detail::_waiter_list::release(waiting);
+			return result;
+		}
+
+		//leaves the barrier, the next phases wait for one participant less
+		void arrive_and_drop() {
+			std::unique_lock<std::mutex> lock(mutex);
+			--participants;
+			if (--remaining > 0)
+				return;
+
+			std::deque<std::promise<void>> waiting = _next_phase();
+			lock.unlock();
+			detail::_waiter_list::release(waiting);
+		}
+
+		unsigned long long current_phase() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return phase;
+		}
+
+	private:
+		//the completion sees the finished phase, nobody can arrive in the next one yet
+		std::deque<std::promise<void>> _next_phase() {
+			if (completion)
+				completion();
+			remaining = participants;
+			++phase;
+			return waiters.take();
+		}
+
+		mutable std::mutex mutex;
+		ptrdiff_t participants;
+		ptrdiff_t remaining;
+		unsigned long long phase;
+		completion_type completion;
+		detail::_waiter_list waiters;
+	};
+
+	/*
+	Event waited on through promises. A manual reset event releases every waiter
+	and stays set until reset(), an auto reset event lets a single waiter through.
+	*/
+	class async_event
+	{
+	public:
+		explicit async_event(bool manual_reset = true, bool initially_set = false)
+			: manual_reset(manual_reset), signaled(initially_set) {
+		}
+
+		async_event(const async_event&) = delete;
+		async_event& operator=(const async_event&) = delete;
+
+		void set() {
+			std::deque<std::promise<void>> waiting;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (manual_reset) {
+					signaled = true;
+					waiting = waiters.take();
+				}
+				else if (waiters.empty()) {
+					signaled = true;
+				}
+				else {
+					waiting.push_back(waiters.take_first());
+				}
+			}
+			detail::_waiter_list::release(waiting);
+		}
+
+		void reset() {
+			std::lock_guard<std::mutex> lock(mutex);
+			signaled = false;
+		}
+
+		promise<void> wait() {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (signaled) {
+				if (false == manual_reset)
+					signaled = false;
+				return detail::_waiter_list::ready();
+			}
+			return waiters.add();
+		}
+
+		bool is_set() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return signaled;
+		}
+
+	private:
+		mutable std::mutex mutex;
+		const bool manual_reset;
+		bool signaled;
+		detail::_waiter_list waiters;
+	};
+}
+
+#endif //ASYNC_LATCH_INCLUDED
\ No newline at end of file
@@ -0,0 +1,349 @@
+#pragma once
+#ifndef ASYNC_MUTEX_INCLUDED
+#define ASYNC_MUTEX_INCLUDED
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <utility>
+#include "./promise.h"
+
+namespace pro
+{
+	/*
+	Counting semaphore handing out its units through promises. Waiters are served
+	in FIFO order - a waiter asking for more units than available holds back the
+	ones behind it. The units are returned when the guard is released or destroyed.
+	Waiters are settled after the internal lock is dropped, so a continuation may
+	release or acquire again. Guards are move-only - promise<guard>.fail(ecb) would
+	copy a rejection and does not compile, use then() or fail(rcb, ecb) instead.
+	*/
+	class async_semaphore
+	{
+		struct _state;
+
+	public:
+		class guard
+		{
+		public:
+			guard() : units(0) {}
+
+			guard(guard&& other) noexcept
+				: state(std::move(other.state)), units(std::exchange(other.units, 0)) {
+			}
+
+			guard& operator=(guard&& other) noexcept {
+				if (this != &other) {
+					release();
+					state = std::move(other.state);
+					units = std::exchange(other.units, 0);
+				}
+				return *this;
+			}
+
+			guard(const guard&) = delete;
+			guard& operator=(const guard&) = delete;
+
+			~guard() {
+				release();
+			}
+
+			void release() {
+				if (state && units > 0)
+					state->release(units);
+				state.reset();
+				units = 0;
+			}
+
+			bool owns_lock() const {
+				return state != nullptr;
+			}
+
+			explicit operator bool() const {
+				return owns_lock();
+			}
+
+		private:
+			friend class async_semaphore;
+
+			guard(std::shared_ptr<_state> state, size_t units)
+				: state(std::move(state)), units(units) {
+			}
+
+			std::shared_ptr<_state> state;
+			size_t units;
+		};
+
+		explicit async_semaphore(size_t count)
+			: state(std::make_shared<_state>(count)) {
+		}
+
+		async_semaphore(const async_semaphore&) = delete;
+		async_semaphore& operator=(const async_semaphore&) = delete;
+
+		promise<guard> acquire(size_t units = 1) {
+			std::unique_lock<std::mutex> lock(state->mutex);
+			if (units > state->capacity)
+				return promise<guard>(std::make_exception_ptr(std::invalid_argument("async_semaphore acquire exceeds its count")));
+
+			if (state->waiters.empty() && units <= state->available) {
+				state->available -= units;
+				lock.unlock();
+				return _granted(guard(state, units));
+			}
+
+			std::promise<guard> waiter;
+			promise<guard> result(waiter.get_future());
+			state->waiters.push_back(_waiter{ units, std::move(waiter) });
+			return result;
+		}
+
+		std::optional<guard> try_acquire(size_t units = 1) {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			if (false == state->waiters.empty() || units > state->available)
+				return std::nullopt;
+
+			state->available -= units;
+			return guard(state, units);
+		}
+
+		size_t available() const {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			return state->available;
+		}
+
+		size_t waiting() const {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			return state->waiters.size();
+		}
+
+	private:
+		struct _waiter {
+			size_t units;
+			std::promise<guard> resolver;
+		};
+
+		//shared with the guards, which may outlive the semaphore
+		struct _state : std::enable_shared_from_this<_state> {
+			explicit _state(size_t count) : capacity(count), available(count) {}
+
+			void release(size_t units) {
+				std::vector<_waiter> granted;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					available += units;
+					while (false == waiters.empty() && waiters.front().units <= available) {
+						available -= waiters.front().units;
+						granted.push_back(std::move(waiters.front()));
+						waiters.pop_front();
+					}
+				}
+
+				//unlocked - a guard whose promise was dropped is destroyed here and releases again
+				for (auto& waiter : granted)
+					waiter.resolver.set_value(guard(shared_from_this(), waiter.units));
+			}
+
+			std::mutex mutex;
+			const size_t capacity;
+			size_t available;
+			std::deque<_waiter> waiters;
+		};
+
+		static promise<guard> _granted(guard g) {
+			std::promise<guard> resolver;
+			resolver.set_value(std::move(g));
+			return promise<guard>(resolver.get_future());
+		}
+
+		std::shared_ptr<_state> state;
+	};
+
+	//exclusive lock, an async_semaphore of one unit
+	class async_mutex
+	{
+	public:
+		using guard = async_semaphore::guard;
+
+		async_mutex() : semaphore(1) {}
+
+		promise<guard> lock() {
+			return semaphore.acquire();
+		}
+
+		std::optional<guard> try_lock() {
+			return semaphore.try_acquire();
+		}
+
+		bool is_locked() const {
+			return semaphore.available() == 0;
+		}
+
+	private:
+		async_semaphore semaphore;
+	};
+
+	/*
+	Read-write lock handing out shared and exclusive guards through promises. Requests
+	are served in FIFO order, so a waiting writer is not starved by later readers.
+	Settling and guards follow async_semaphore.
+	*/
+	class async_shared_mutex
+	{
+		struct _state;
+
+	public:
+		class guard
+		{
+		public:
+			guard() : exclusive(false) {}
+
+			guard(guard&& other) noexcept
+				: state(std::move(other.state)), exclusive(other.exclusive) {
+			}
+
+			guard& operator=(guard&& other) noexcept {
+				if (this != &other) {
+					release();
+					state = std::move(other.state);
+					exclusive = other.exclusive;
+				}
+				return *this;
+			}
+
+			guard(const guard&) = delete;
+			guard& operator=(const guard&) = delete;
+
+			~guard() {
+				release();
+			}
+
+			void release() {
+				if (state)
+					state->release(exclusive);
+				state.reset();
+			}
+
+			bool owns_lock() const {
+				return state != nullptr;
+			}
+
+			bool is_exclusive() const {
+				return owns_lock() && exclusive;
+			}
+
+			explicit operator bool() const {
+				return owns_lock();
+			}
+
+		private:
+			friend class async_shared_mutex;
+
+			guard(std::shared_ptr<_state> state, bool exclusive)
+				: state(std::move(state)), exclusive(exclusive) {
+			}
+
+			std::shared_ptr<_state> state;
+			bool exclusive;
+		};
+
+		async_shared_mutex() : state(std::make_shared<_state>()) {}
+
+		async_shared_mutex(const async_shared_mutex&) = delete;
+		async_shared_mutex& operator=(const async_shared_mutex&) = delete;
+
+		promise<guard> lock() {
+			return _request(true);
+		}
+
+		promise<guard> lock_shared() {
+			return _request(false);
+		}
+
+		std::optional<guard> try_lock() {
+			return _try_request(true);
+		}
+
+		std::optional<guard> try_lock_shared() {
+			return _try_request(false);
+		}
+
+	private:
+		struct _waiter {
+			bool exclusive;
+			std::promise<guard> resolver;
+		};
+
+		struct _state : std::enable_shared_from_this<_state> {
+			_state() : readers(0), writer(false) {}
+
+			bool can_grant(bool exclusive) const {
+				return exclusive ? (false == writer && readers == 0) : false == writer;
+			}
+
+			void grant(bool exclusive) {
+				if (exclusive)
+					writer = true;
+				else
+					++readers;
+			}
+
+			void release(bool exclusive) {
+				std::vector<_waiter> granted;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (exclusive)
+						writer = false;
+					else
+						--readers;
+
+					while (false == waiters.empty() && can_grant(waiters.front().exclusive)) {
+						grant(waiters.front().exclusive);
+						granted.push_back(std::move(waiters.front()));
+						waiters.pop_front();
+					}
+				}
+
+				for (auto& waiter : granted)
+					waiter.resolver.set_value(guard(shared_from_this(), waiter.exclusive));
+			}
+
+			std::mutex mutex;
+			size_t readers;
+			bool writer;
+			std::deque<_waiter> waiters;
+		};
+
+		promise<guard> _request(bool exclusive) {
+			std::unique_lock<std::mutex> lock(state->mutex);
+			if (state->waiters.empty() && state->can_grant(exclusive)) {
+				state->grant(exclusive);
+				lock.unlock();
+
+				std::promise<guard> resolver;
+				resolver.set_value(guard(state, exclusive));
+				return promise<guard>(resolver.get_future());
+			}
+
+			std::promise<guard> waiter;
+			promise<guard> result(waiter.get_future());
+			state->waiters.push_back(_waiter{ exclusive, std::move(waiter) });
+			return result;
+		}
+
+		std::optional<guard> _try_request(bool exclusive) {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			if (false == state->waiters.empty() || false == state->can_grant(exclusive))
+				return std::nullopt;
+
+			state->grant(exclusive);
+			return guard(state, exclusive);
+		}
+
+		std::shared_ptr<_state> state;
+	};
+}
+
+#endif //ASYNC_MUTEX_INCLUDED
\ No newline at end of file
@@ -3,12 +3,41 @@
 #define PROMISE_BASE_INCLUDED
 
 #include <future>
+#include <thread>
+#include <memory_resource>
 #include "./pool.h"
 
 namespace pro
 {
 	namespace detail
 	{
+		//a thread joined by its owner on destruction or reassignment, never detached
+		class _joined_thread {
+		public:
+			_joined_thread() = default;
+			template<typename Function>
+			explicit _joined_thread(Function&& fun) : t(std::forward<Function>(fun)) {}
+			_joined_thread(_joined_thread&&) noexcept = default;
+
+			_joined_thread& operator=(_joined_thread&& other) noexcept {
+				join();
+				t = std::move(other.t);
+				return *this;
+			}
+
+			~_joined_thread() {
+				join();
+			}
+
+		private:
+			void join() {
+				if (t.joinable())
+					t.join();
+			}
+
+			std::thread t;
+		};
+
 		template<typename T>
 		class _promise_base {
 		public:
@@ -21,6 +50,33 @@ namespace pro
 				_promise_base(Function&& fun, Args&&... args) :
 				future(std::async(std::launch::async, std::forward<Function>(fun), std::forward<Args>(args)...)) {
 			}
+			/*
+			The shared state is allocated with the allocator, which has to outlive both ends of it.
+			The method runs on a thread owned by the promise, joined by its destructor like std::async.
+			Only this state uses the allocator: the thread itself, the states of .then()/.fail()
+			and of the combinators are allocated from the global heap.
+			*/
+			template<typename Alloc, typename Function, typename... Args,
+				typename = std::enable_if_t<std::is_invocable_r_v<T, Function, Args...>> >
+				_promise_base(std::allocator_arg_t, const Alloc& alloc, Function&& fun, Args&&... args) {
+				resolver_type resolver(std::allocator_arg, alloc);
+				this->future = resolver.get_future();
+				this->worker = _joined_thread([resolver = std::move(resolver), fun = std::forward<Function>(fun),
+					args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+					try {
+						if constexpr (std::is_void<T>::value) {
+							std::apply(fun, std::move(args));
+							resolver.set_value();
+						}
+						else {
+							resolver.set_value(std::apply(fun, std::move(args)));
+						}
+					}
+					catch (...) {
+						resolver.set_exception(std::current_exception());
+					}
+				});
+			}
 			explicit _promise_base(const resolver_fn_type& fun) {
 				resolver_type resolver;
 				this->future = resolver.get_future();
@@ -28,7 +84,7 @@ namespace pro
 				t.detach();
 			}
 			_promise_base(_promise_base<T>&& _promise) noexcept :
-				future(std::move(_promise.future)) {
+				future(std::move(_promise.future)), worker(std::move(_promise.worker)) {
 			}
 			_promise_base(std::future<T>&& _future) :
 				future(std::move(_future)) {
@@ -92,9 +148,10 @@ namespace pro
 			}
 
 		private:
+			//the running method (and the thread of an allocator promise) is handed to the pool with the old state
 			std::promise<T> detach_and_reset() {
 				std::promise<T> _promise;
-				_promise_base<T> _pb(std::move(this->future));
+				_promise_base<T> _pb(std::move(*this));
 				_pb.async();
 				this->future = _promise.get_future();
 				return _promise;
@@ -102,6 +159,9 @@ namespace pro
 
 		protected:
 			std::future<T> future;
+
+		private:
+			_joined_thread worker;
 		};
 	}
 }
@@ -0,0 +1,153 @@
+#pragma once
+#ifndef BATCHER_INCLUDED
+#define BATCHER_INCLUDED
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include "./promise.h"
+#include "./utils/timer.h"
+#include "./utils/detached.h"
+
+namespace pro
+{
+	/*
+	Collects keys requested one by one and loads them with a single batch call.
+	A batch is dispatched when it reaches max_batch distinct keys or when `tick` passes
+	after its first key, whichever comes first. A key requested again within the batch
+	shares its slot. The batch function must return one value per key, in the order of the keys.
+	*/
+	template<typename K, typename V, typename Hash = std::hash<K>, typename = std::enable_if_t<!std::is_void<V>::value>>
+	class batcher
+	{
+	public:
+		using clock = detail::timer_queue::clock;
+		using batch_fn_type = std::function<promise<std::vector<V>>(std::vector<K>)>;
+
+		batcher(batch_fn_type batch_fn, size_t max_batch = 64, clock::duration tick = std::chrono::milliseconds(1))
+			: state(std::make_shared<_state>(std::move(batch_fn), max_batch, tick)) {}
+
+		batcher(const batcher&) = delete;
+
+		~batcher() {
+			flush();
+		}
+
+		promise<V> load(const K& key) {
+			std::promise<V> waiter;
+			promise<V> result(waiter.get_future());
+
+			std::unique_lock<std::mutex> lock(state->mutex);
+			auto slot = state->slots.find(key);
+			if (slot != state->slots.end()) {
+				state->waiters[slot->second].push_back(std::move(waiter));
+				return result;
+			}
+
+			state->slots.emplace(key, state->keys.size());
+			state->keys.push_back(key);
+			state->waiters.emplace_back();
+			state->waiters.back().push_back(std::move(waiter));
+
+			if (state->keys.size() >= state->max_batch) {
+				_state::dispatch(state, lock);
+			}
+			else if (state->keys.size() == 1) {
+				std::weak_ptr<_state> weak = state;
+				unsigned long long generation = state->generation;
+				state->timer = detail::_timers().schedule(state->tick, [weak, generation] {
+					if (auto owner = weak.lock()) {
+						std::unique_lock<std::mutex> lock(owner->mutex);
+						//the batch it was started for may be gone, cancelled too late
+						if (owner->generation == generation)
+							_state::dispatch(owner, lock);
+					}
+				});
+			}
+			return result;
+		}
+
+		//dispatches the collected keys right away
+		void flush() {
+			std::unique_lock<std::mutex> lock(state->mutex);
+			_state::dispatch(state, lock);
+		}
+
+	private:
+		struct _state {
+			_state(batch_fn_type batch_fn, size_t max_batch, clock::duration tick)
+				: batch_fn(std::move(batch_fn)), max_batch(std::max<size_t>(1, max_batch)), tick(tick), timer(0), generation(0) {}
+
+			//takes the collected batch out and releases the lock before calling the batch function
+			static void dispatch(const std::shared_ptr<_state>& self, std::unique_lock<std::mutex>& lock) {
+				if (self->keys.empty())
+					return;
+
+				detail::_timers().cancel(self->timer);
+				++self->generation;
+				std::vector<K> batch_keys;
+				auto batch_waiters = std::make_shared<std::vector<std::vector<std::promise<V>>>>();
+				batch_keys.swap(self->keys);
+				batch_waiters->swap(self->waiters);
+				self->slots.clear();
+				lock.unlock();
+
+				promise<std::vector<V>> batch = _call(self->batch_fn, std::move(batch_keys));
+				detail::_settle_detached(std::move(batch),
+					[batch_waiters](std::vector<V> values) {
+						if (values.size() != batch_waiters->size()) {
+							_reject_all(*batch_waiters, std::make_exception_ptr(
+								std::length_error("batch function returned a different number of values than keys")));
+							return;
+						}
+						for (size_t i = 0; i < values.size(); ++i) {
+							auto& waiters = (*batch_waiters)[i];
+							for (size_t j = 0; j + 1 < waiters.size(); ++j)
+								waiters[j].set_value(values[i]);
+							waiters.back().set_value(std::move(values[i]));
+						}
+					},
+					[batch_waiters](std::vector<V> rejection) {
+						_reject_all(*batch_waiters, std::make_exception_ptr(std::move(rejection)));
+					},
+					[batch_waiters](std::exception_ptr eptr) {
+						_reject_all(*batch_waiters, eptr);
+					});
+			}
+
+			static promise<std::vector<V>> _call(batch_fn_type& batch_fn, std::vector<K>&& batch_keys) {
+				try {
+					return batch_fn(std::move(batch_keys));
+				}
+				catch (...) {
+					return promise<std::vector<V>>(std::current_exception());
+				}
+			}
+
+			static void _reject_all(std::vector<std::vector<std::promise<V>>>& batch_waiters, std::exception_ptr eptr) {
+				for (auto& waiters : batch_waiters) {
+					for (auto& waiter : waiters)
+						waiter.set_exception(eptr);
+				}
+			}
+
+			batch_fn_type batch_fn;
+			const size_t max_batch;
+			const clock::duration tick;
+
+			std::mutex mutex;
+			std::vector<K> keys;
+			//waiters of keys[i], more than one when the key was requested again
+			std::vector<std::vector<std::promise<V>>> waiters;
+			std::unordered_map<K, size_t, Hash> slots;
+			detail::_timers_type::timer_id timer;
+			//counts dispatched batches, tells a stale timer from the current one
+			unsigned long long generation;
+		};
+
+		std::shared_ptr<_state> state;
+	};
+}
+
+#endif //BATCHER_INCLUDED
\ No newline at end of file
@@ -0,0 +1,193 @@
+#pragma once
+#ifndef CHANNEL_INCLUDED
+#define CHANNEL_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <optional>
+#include <mutex>
+#include "./promise.h"
+
+namespace pro
+{
+	class ChannelClosedException : public std::exception {
+	public:
+		const char* what() const noexcept override {
+			return "Channel is closed";
+		}
+	};
+
+	/*
+	Bounded multi-producer multi-consumer channel. Items are kept in a ring buffer
+	allocated once; a sender finding it full and a receiver finding it empty get a
+	pending promise instead of blocking. A capacity of 0 hands every item directly
+	from a sender to a receiver. After close() the buffered items can still be
+	received, everything else is rejected with ChannelClosedException.
+	Only try_send/try_receive are allocation-free, send and receive always allocate
+	the shared state of the promise they return.
+	*/
+	template<typename T>
+	class channel
+	{
+	public:
+		explicit channel(size_t capacity)
+			: ring(capacity), head(0), count(0), closed(false) {
+		}
+
+		channel(const channel&) = delete;
+		channel& operator=(const channel&) = delete;
+
+		//fulfills once the item is buffered or taken by a receiver
+		promise<void> send(T item) {
+			std::unique_lock<std::mutex> lock(mutex);
+			if (closed)
+				return promise<void>(std::make_exception_ptr(ChannelClosedException()));
+
+			if (_offer(item, lock))
+				return _ready();
+
+			std::promise<void> waiter;
+			promise<void> result(waiter.get_future());
+			senders.push_back(_sender{ std::move(item), std::move(waiter) });
+			return result;
+		}
+
+		promise<T> receive() {
+			std::unique_lock<std::mutex> lock(mutex);
+			std::optional<T> item = _take(lock);
+			if (item)
+				return _ready(std::move(*item));
+			if (closed)
+				return promise<T>(std::make_exception_ptr(ChannelClosedException()));
+
+			std::promise<T> waiter;
+			promise<T> result(waiter.get_future());
+			receivers.push_back(std::move(waiter));
+			return result;
+		}
+
+		//non-waiting variants, nothing is allocated for the handoff
+		//the item is moved from only when true is returned
+		bool try_send(T&& item) {
+			std::unique_lock<std::mutex> lock(mutex);
+			if (closed)
+				return false;
+			return _offer(item, lock);
+		}
+
+		std::optional<T> try_receive() {
+			std::unique_lock<std::mutex> lock(mutex);
+			return _take(lock);
+		}
+
+		void close() {
+			std::deque<_sender> rejected_senders;
+			std::deque<std::promise<T>> rejected_receivers;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (closed)
+					return;
+				closed = true;
+				rejected_senders.swap(senders);
+				//receivers only wait on an empty buffer
+				rejected_receivers.swap(receivers);
+			}
+
+			for (auto& sender : rejected_senders)
+				sender.waiter.set_exception(std::make_exception_ptr(ChannelClosedException()));
+			for (auto& receiver : rejected_receivers)
+				receiver.set_exception(std::make_exception_ptr(ChannelClosedException()));
+		}
+
+		bool is_closed() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return closed;
+		}
+
+		size_t size() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return count;
+		}
+
+		size_t capacity() const {
+			return ring.size();
+		}
+
+	private:
+		struct _sender {
+			T item;
+			std::promise<void> waiter;
+		};
+
+		//hands the item to a waiting receiver or buffers it, settles outside the lock
+		bool _offer(T& item, std::unique_lock<std::mutex>& lock) {
+			if (false == receivers.empty()) {
+				std::promise<T> receiver = std::move(receivers.front());
+				receivers.pop_front();
+				lock.unlock();
+				receiver.set_value(std::move(item));
+				return true;
+			}
+			if (count < ring.size()) {
+				ring[(head + count) % ring.size()].emplace(std::move(item));
+				++count;
+				return true;
+			}
+			return false;
+		}
+
+		//takes the oldest item, the first waiting sender moves into the freed slot
+		std::optional<T> _take(std::unique_lock<std::mutex>& lock) {
+			std::optional<T> item;
+			std::optional<std::promise<void>> released;
+
+			if (count > 0) {
+				item = std::move(ring[head]);
+				ring[head].reset();
+				head = (head + 1) % ring.size();
+				--count;
+
+				if (false == senders.empty()) {
+					ring[(head + count) % ring.size()].emplace(std::move(senders.front().item));
+					++count;
+					released = std::move(senders.front().waiter);
+					senders.pop_front();
+				}
+			}
+			else if (false == senders.empty()) {
+				item = std::move(senders.front().item);
+				released = std::move(senders.front().waiter);
+				senders.pop_front();
+			}
+
+			if (released) {
+				lock.unlock();
+				released->set_value();
+			}
+			return item;
+		}
+
+		static promise<void> _ready() {
+			std::promise<void> resolver;
+			resolver.set_value();
+			return promise<void>(resolver.get_future());
+		}
+
+		static promise<T> _ready(T item) {
+			std::promise<T> resolver;
+			resolver.set_value(std::move(item));
+			return promise<T>(resolver.get_future());
+		}
+
+		mutable std::mutex mutex;
+		std::vector<std::optional<T>> ring;
+		size_t head;
+		size_t count;
+		bool closed;
+
+		std::deque<_sender> senders;
+		std::deque<std::promise<T>> receivers;
+	};
+}
+
+#endif //CHANNEL_INCLUDED
\ No newline at end of file
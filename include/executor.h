@@ -0,0 +1,144 @@
+#pragma once
+#ifndef EXECUTOR_INCLUDED
+#define EXECUTOR_INCLUDED
+
+#include <queue>
+#include <vector>
+#include <tuple>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include "./promise.h"
+#include "./recycling_resource.h"
+
+namespace pro
+{
+	/*
+	Fixed pool of worker threads running submitted tasks, higher priority first,
+	FIFO among equal priorities. Tasks waiting for other tasks of the same pool
+	can starve it - submit continuations instead of blocking.
+	*/
+	class executor
+	{
+	public:
+		using task_type = std::function<void()>;
+
+		explicit executor(unsigned int threads = std::max(2u, std::thread::hardware_concurrency()))
+			: stopping(false), next_seq(0), tasks(_task_order(), std::pmr::vector<_task>(detail::_recycling<_task>())) {
+			for (unsigned int i = 0; i < std::max(1u, threads); ++i)
+				workers.emplace_back(&executor::work, this, i);
+		}
+
+		executor(const executor&) = delete;
+		executor& operator=(const executor&) = delete;
+
+		//finishes the queued tasks before the workers are joined
+		~executor() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			cv.notify_all();
+			for (auto& worker : workers)
+				worker.join();
+		}
+
+		static executor& shared() {
+			static executor instance_;
+			return instance_;
+		}
+
+		void submit(task_type task, int priority = 0) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				tasks.push(_task{ priority, next_seq++, std::move(task) });
+			}
+			cv.notify_one();
+		}
+
+		//runs the function on the pool, the outcome is delivered through the returned promise
+		template<typename T, typename Function, typename... Args,
+			typename = std::enable_if_t<std::is_invocable_r_v<T, Function, Args...>>>
+		promise<T> run(Function&& fun, Args&&... args) {
+			auto resolver = std::make_shared<std::promise<T>>(std::allocator_arg, detail::_recycling());
+			promise<T> result(resolver->get_future());
+
+			submit([resolver, fun = std::forward<Function>(fun), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+				try {
+					if constexpr (std::is_void<T>::value) {
+						std::apply(fun, std::move(args));
+						resolver->set_value();
+					}
+					else {
+						resolver->set_value(std::apply(fun, std::move(args)));
+					}
+				}
+				catch (...) {
+					resolver->set_exception(std::current_exception());
+				}
+			});
+			return result;
+		}
+
+		size_t threads() const {
+			return workers.size();
+		}
+
+		//index of the calling worker of this pool, -1 when called from any other thread
+		int worker_index() const {
+			return current_pool == this ? current_worker : -1;
+		}
+
+	private:
+		struct _task {
+			int priority;
+			unsigned long long seq;
+			task_type fn;
+		};
+
+		struct _task_order {
+			bool operator()(const _task& a, const _task& b) const {
+				if (a.priority != b.priority)
+					return a.priority < b.priority;
+				return a.seq > b.seq;
+			}
+		};
+
+		void work(unsigned int index) {
+			current_pool = this;
+			current_worker = static_cast<int>(index);
+
+			std::unique_lock<std::mutex> lock(mutex);
+			while (true) {
+				cv.wait(lock, [this] { return stopping || false == tasks.empty(); });
+				if (tasks.empty())
+					return;
+
+				task_type task = std::move(const_cast<_task&>(tasks.top()).fn);
+				tasks.pop();
+
+				lock.unlock();
+				try {
+					task();
+				}
+				catch (...) {
+					//a submitted task has nobody to report to, use run() to observe failures
+				}
+				lock.lock();
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool stopping;
+		unsigned long long next_seq;
+		std::priority_queue<_task, std::pmr::vector<_task>, _task_order> tasks;
+		std::vector<std::thread> workers;
+
+		inline static thread_local const executor* current_pool = nullptr;
+		inline static thread_local int current_worker = -1;
+	};
+}
+
+#endif //EXECUTOR_INCLUDED
\ No newline at end of file
@@ -0,0 +1,605 @@
+#pragma once
+#ifndef IO_FILE_INCLUDED
+#define IO_FILE_INCLUDED
+
+#ifdef __linux__
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <atomic>
+#include <initializer_list>
+#include <system_error>
+#include <thread>
+#include <mutex>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "./../promise.h"
+#include "./../executor.h"
+
+namespace pro
+{
+	namespace fs
+	{
+		enum class backend {
+			io_uring,
+			thread_pool
+		};
+
+		namespace detail
+		{
+			//completion of one operation, called with the byte count (or descriptor) or -errno
+			using _completion_type = std::function<void(int)>;
+
+			inline io_uring_sqe _prepare(uint8_t opcode, int file, uint64_t offset, const void* address, unsigned int length) {
+				io_uring_sqe sqe;
+				std::memset(&sqe, 0, sizeof(sqe));
+				sqe.opcode = opcode;
+				sqe.fd = file;
+				sqe.off = offset;
+				sqe.addr = reinterpret_cast<uint64_t>(address);
+				sqe.len = length;
+				return sqe;
+			}
+
+			/*
+			Bare io_uring: the rings are mapped once, operations are pushed to the
+			submission ring under a lock and one thread reaps the completions.
+			Reads and writes into a registered buffer become their _FIXED variants.
+			Completions overflowing the ring are kept by the kernel (IORING_FEAT_NODROP)
+			and flushed by the reaper. On destruction the operations still in flight are
+			cancelled and drained, so every completion runs - with -ECANCELED if cancelled.
+			*/
+			class _uring
+			{
+			public:
+				explicit _uring(unsigned int entries) : fd(-1), pending(0), draining(false), sq_ptr(MAP_FAILED), cq_ptr(MAP_FAILED), sqes(nullptr) {
+					io_uring_params params{};
+					//completions are reaped by one thread, room for a backlog of them
+					params.flags = IORING_SETUP_CQSIZE;
+					params.cq_entries = entries * 8;
+
+					fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+					if (fd < 0)
+						throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+					//kernels before 5.6 set up a ring but reject the operations used here
+					if (0 == (params.features & IORING_FEAT_NODROP)
+						|| false == _supports({ IORING_OP_READ, IORING_OP_WRITE, IORING_OP_OPENAT, IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED, IORING_OP_ASYNC_CANCEL })) {
+						::close(fd);
+						throw std::system_error(EOPNOTSUPP, std::generic_category(), "io_uring probe");
+					}
+
+					sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+					cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+					bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+					if (single_mmap)
+						sq_size = cq_size = std::max(sq_size, cq_size);
+
+					sq_ptr = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+					cq_ptr = single_mmap ? sq_ptr
+						: ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+					sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+					void* sqes_ptr = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+					if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes_ptr == MAP_FAILED) {
+						int error = errno;
+						if (sqes_ptr != MAP_FAILED)
+							::munmap(sqes_ptr, sqes_size);
+						_unmap();
+						throw std::system_error(error, std::generic_category(), "io_uring mmap");
+					}
+
+					char* sq = static_cast<char*>(sq_ptr);
+					sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+					sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+					sq_flags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+					sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+					sq_entries = params.sq_entries;
+					sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+					sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+					char* cq = static_cast<char*>(cq_ptr);
+					cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+					cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+					cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+					cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+					reaper = std::thread(&_uring::_reap, this);
+				}
+
+				_uring(const _uring&) = delete;
+				_uring& operator=(const _uring&) = delete;
+
+				~_uring() {
+					drain();
+					::munmap(sqes, sqes_size);
+					_unmap();
+				}
+
+				void submit(io_uring_sqe sqe, _completion_type done, bool flush) {
+					auto completion = new _completion_type(std::move(done));
+					{
+						std::unique_lock<std::mutex> lock(live_mutex);
+						//submitted by a completion run while draining
+						if (draining) {
+							lock.unlock();
+							(*completion)(-ECANCELED);
+							delete completion;
+							return;
+						}
+						live.insert(completion);
+					}
+					sqe.user_data = reinterpret_cast<uint64_t>(completion);
+					_push(sqe, flush);
+				}
+
+				//cancels the operations in flight and stops the reaper once their completions ran
+				void drain() {
+					if (false == reaper.joinable())
+						return;
+
+					std::vector<_completion_type*> in_flight;
+					{
+						std::lock_guard<std::mutex> lock(live_mutex);
+						draining = true;
+						in_flight.assign(live.begin(), live.end());
+					}
+					for (auto completion : in_flight) {
+						io_uring_sqe cancel = _prepare(IORING_OP_ASYNC_CANCEL, -1, 0, completion, 0);
+						cancel.user_data = _cancel_data;
+						_push(cancel, false);
+					}
+
+					//a no-op without a completion stops the reaper
+					_push(_prepare(IORING_OP_NOP, -1, 0, nullptr, 0), true);
+					reaper.join();
+				}
+
+				//pins the buffers for the whole life of the ring, replacing the ones registered before
+				void register_buffers(const std::vector<iovec>& buffers) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (false == registered.empty())
+						::syscall(__NR_io_uring_register, fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+					registered.clear();
+					if (buffers.empty())
+						return;
+
+					if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size())) < 0)
+						throw std::system_error(errno, std::generic_category(), "io_uring_register");
+					registered = buffers;
+				}
+
+				void flush() {
+					std::lock_guard<std::mutex> lock(mutex);
+					_enter();
+				}
+
+			private:
+				//user_data of the requests without a completion
+				static constexpr uint64_t _stop_data = 0;
+				static constexpr uint64_t _cancel_data = 1;
+
+				bool _supports(std::initializer_list<uint8_t> opcodes) {
+					std::vector<char> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+					auto probe = reinterpret_cast<io_uring_probe*>(storage.data());
+					if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+						return false;
+
+					for (auto opcode : opcodes) {
+						if (opcode > probe->last_op || 0 == (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED))
+							return false;
+					}
+					return true;
+				}
+
+				//a read or write landing entirely in a registered buffer skips the page pinning
+				void _use_fixed(io_uring_sqe& sqe) const {
+					if (sqe.opcode != IORING_OP_READ && sqe.opcode != IORING_OP_WRITE)
+						return;
+
+					auto begin = static_cast<uintptr_t>(sqe.addr);
+					for (size_t i = 0; i < registered.size(); ++i) {
+						auto base = reinterpret_cast<uintptr_t>(registered[i].iov_base);
+						if (begin >= base && begin + sqe.len <= base + registered[i].iov_len) {
+							sqe.opcode = sqe.opcode == IORING_OP_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+							sqe.buf_index = static_cast<uint16_t>(i);
+							return;
+						}
+					}
+				}
+
+				void _push(io_uring_sqe prepared, bool flush) {
+					std::lock_guard<std::mutex> lock(mutex);
+					_use_fixed(prepared);
+					unsigned int tail = *sq_tail;
+					//held back by a batch - hand it over to the kernel to make room
+					if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == sq_entries)
+						_enter();
+
+					unsigned int index = tail & sq_mask;
+					sqes[index] = prepared;
+					sq_array[index] = index;
+
+					__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+					++pending;
+					if (flush)
+						_enter();
+				}
+
+				void _enter() {
+					while (pending > 0) {
+						int submitted = static_cast<int>(::syscall(__NR_io_uring_enter, fd, pending, 0, 0, nullptr, 0));
+						if (submitted < 0) {
+							if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+								continue;
+							return;
+						}
+						pending -= submitted;
+					}
+				}
+
+				void _reap() {
+					bool stopping = false;
+					std::vector<std::pair<_completion_type*, int>> completed;
+					while (true) {
+						//overflowed completions are moved into the ring by GETEVENTS, do not sleep on them
+						bool overflow = __atomic_load_n(sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW;
+						if (::syscall(__NR_io_uring_enter, fd, 0, overflow ? 0 : 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0
+							&& errno != EINTR && errno != EBUSY)
+							return;
+
+						unsigned int head = *cq_head;
+						unsigned int tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+						for (; head != tail; ++head) {
+							io_uring_cqe& cqe = cqes[head & cq_mask];
+							if (cqe.user_data == _stop_data)
+								stopping = true;
+							else if (cqe.user_data != _cancel_data)
+								completed.emplace_back(reinterpret_cast<_completion_type*>(cqe.user_data), cqe.res);
+						}
+						__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+						{
+							std::lock_guard<std::mutex> lock(live_mutex);
+							for (auto& completion : completed)
+								live.erase(completion.first);
+						}
+						for (auto& completion : completed) {
+							(*completion.first)(completion.second);
+							delete completion.first;
+						}
+						completed.clear();
+
+						if (stopping) {
+							std::lock_guard<std::mutex> lock(live_mutex);
+							if (live.empty())
+								return;
+						}
+					}
+				}
+
+				void _unmap() {
+					if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+						::munmap(cq_ptr, cq_size);
+					if (sq_ptr != MAP_FAILED)
+						::munmap(sq_ptr, sq_size);
+					::close(fd);
+				}
+
+				int fd;
+				std::mutex mutex;
+				unsigned int pending;
+				std::vector<iovec> registered;
+
+				//submitted and not yet reaped, own lock as the reaper must not wait for a blocked submitter
+				std::mutex live_mutex;
+				std::unordered_set<_completion_type*> live;
+				bool draining;
+
+				void* sq_ptr;
+				void* cq_ptr;
+				size_t sq_size;
+				size_t cq_size;
+				size_t sqes_size;
+
+				unsigned* sq_head;
+				unsigned* sq_tail;
+				unsigned* sq_flags;
+				unsigned* sq_array;
+				unsigned int sq_mask;
+				unsigned int sq_entries;
+				io_uring_sqe* sqes;
+
+				unsigned* cq_head;
+				unsigned* cq_tail;
+				unsigned int cq_mask;
+				io_uring_cqe* cqes;
+
+				std::thread reaper;
+			};
+		}
+
+		/*
+		Holds back io_uring submissions made by this thread to the service until the
+		outermost batch on it ends, so they reach the kernel with a single system call.
+		*/
+		class batch;
+
+		/*
+		Positional file I/O through promises. Uses io_uring when the kernel supports the
+		operations, otherwise a dedicated pool of threads doing blocking open/pread/pwrite.
+		Buffers are owned by the caller and have to outlive the operation - data is read
+		and written in place, registered buffers are not even pinned per operation.
+		*/
+		class file_service
+		{
+		public:
+			explicit file_service(backend preferred = backend::io_uring, unsigned int entries = 256, unsigned int pool_threads = 4)
+				: used(backend::thread_pool), batches(0) {
+				if (preferred == backend::io_uring) {
+					try {
+						ring = std::make_unique<detail::_uring>(entries);
+						used = backend::io_uring;
+					}
+					catch (std::system_error&) {
+						//io_uring disabled or not supported, fall back to the pool
+					}
+				}
+				if (used == backend::thread_pool)
+					pool = std::make_unique<executor>(pool_threads);
+			}
+
+			//operations in flight are cancelled - their promises reject with ECANCELED unless they finished first
+			~file_service() {
+				if (ring)
+					ring->drain();
+			}
+
+			file_service(const file_service&) = delete;
+			file_service& operator=(const file_service&) = delete;
+
+			static file_service& shared() {
+				static file_service instance_;
+				return instance_;
+			}
+
+			backend get_backend() const {
+				return used;
+			}
+
+			/*
+			Registers the caller's buffers with io_uring (replacing the previous set), later
+			reads and writes falling within one of them use it. The buffers must stay alive
+			until they are replaced. Nothing to do for the thread pool.
+			*/
+			void register_buffers(const std::vector<iovec>& buffers) {
+				if (ring)
+					ring->register_buffers(buffers);
+			}
+
+			promise<size_t> read(int fd, uint64_t offset, void* buffer, size_t size) {
+				auto resolver = std::make_shared<std::promise<size_t>>();
+				promise<size_t> result(resolver->get_future());
+				_submit(IORING_OP_READ, fd, offset, buffer, size, _settle(resolver, "read"));
+				return result;
+			}
+
+			promise<size_t> write(int fd, uint64_t offset, const void* buffer, size_t size) {
+				auto resolver = std::make_shared<std::promise<size_t>>();
+				promise<size_t> result(resolver->get_future());
+				_submit(IORING_OP_WRITE, fd, offset, const_cast<void*>(buffer), size, _settle(resolver, "write"));
+				return result;
+			}
+
+			promise<size_t> read(const std::string& path, uint64_t offset, void* buffer, size_t size) {
+				return _with_file(path, O_RDONLY, IORING_OP_READ, offset, buffer, size, "read");
+			}
+
+			promise<size_t> write(const std::string& path, uint64_t offset, const void* buffer, size_t size) {
+				return _with_file(path, O_WRONLY | O_CREAT, IORING_OP_WRITE, offset, const_cast<void*>(buffer), size, "write");
+			}
+
+			//whole file, read in as few operations as its size allows
+			promise<std::string> read_file(const std::string& path) {
+				auto state = std::make_shared<_whole_file>();
+				promise<std::string> result(state->resolver.get_future());
+
+				_open(path, O_RDONLY, [this, state, path](int fd) {
+					if (fd < 0) {
+						state->resolver.set_exception(std::make_exception_ptr(std::system_error(-fd, std::generic_category(), path)));
+						return;
+					}
+
+					state->fd = fd;
+					struct stat info;
+					if (::fstat(fd, &info) == 0 && info.st_size > 0)
+						state->data.resize(static_cast<size_t>(info.st_size));
+					_read_next(state);
+				});
+				return result;
+			}
+
+		private:
+			friend class batch;
+
+			struct _whole_file {
+				~_whole_file() {
+					if (fd >= 0)
+						::close(fd);
+				}
+
+				int fd = -1;
+				std::string data;
+				size_t filled = 0;
+				std::promise<std::string> resolver;
+			};
+
+			void _submit(uint8_t opcode, int fd, uint64_t offset, void* buffer, size_t size, detail::_completion_type done) {
+				unsigned int length = static_cast<unsigned int>(std::min<size_t>(size, 0x7ffff000));
+				if (ring) {
+					ring->submit(detail::_prepare(opcode, fd, offset, buffer, length), std::move(done), false == _batched());
+					return;
+				}
+
+				pool->submit([opcode, fd, offset, buffer, length, done = std::move(done)] {
+					ssize_t n = opcode == IORING_OP_READ
+						? ::pread(fd, buffer, length, static_cast<off_t>(offset))
+						: ::pwrite(fd, buffer, length, static_cast<off_t>(offset));
+					done(n < 0 ? -errno : static_cast<int>(n));
+				});
+			}
+
+			//completes with the new descriptor, opened by the ring as well
+			void _open(const std::string& path, int flags, detail::_completion_type done) {
+				auto name = std::make_shared<std::string>(path);
+				if (ring) {
+					io_uring_sqe sqe = detail::_prepare(IORING_OP_OPENAT, AT_FDCWD, 0, name->c_str(), 0644);
+					sqe.open_flags = static_cast<uint32_t>(flags | O_CLOEXEC);
+					ring->submit(sqe, [name, done = std::move(done)](int res) { done(res); }, false == _batched());
+					return;
+				}
+
+				pool->submit([name, flags, done = std::move(done)] {
+					int fd = ::open(name->c_str(), flags | O_CLOEXEC, 0644);
+					done(fd < 0 ? -errno : fd);
+				});
+			}
+
+			//whether the calling thread has a batch open on this service
+			bool _batched() {
+				if (batches.load(std::memory_order_acquire) == 0)
+					return false;
+				std::lock_guard<std::mutex> lock(batch_mutex);
+				return batch_depth.count(std::this_thread::get_id()) > 0;
+			}
+
+			void _begin_batch() {
+				std::lock_guard<std::mutex> lock(batch_mutex);
+				++batch_depth[std::this_thread::get_id()];
+				batches.fetch_add(1, std::memory_order_release);
+			}
+
+			//true when the outermost batch of the calling thread ended
+			bool _end_batch() {
+				std::lock_guard<std::mutex> lock(batch_mutex);
+				batches.fetch_sub(1, std::memory_order_release);
+				auto depth = batch_depth.find(std::this_thread::get_id());
+				if (--depth->second > 0)
+					return false;
+				batch_depth.erase(depth);
+				return true;
+			}
+
+			static detail::_completion_type _settle(std::shared_ptr<std::promise<size_t>> resolver, const char* what) {
+				return [resolver, what](int res) {
+					if (res < 0)
+						resolver->set_exception(std::make_exception_ptr(std::system_error(-res, std::generic_category(), what)));
+					else
+						resolver->set_value(static_cast<size_t>(res));
+				};
+			}
+
+			promise<size_t> _with_file(const std::string& path, int flags, uint8_t opcode, uint64_t offset, void* buffer, size_t size, const char* what) {
+				auto resolver = std::make_shared<std::promise<size_t>>();
+				promise<size_t> result(resolver->get_future());
+
+				_open(path, flags, [this, path, opcode, offset, buffer, size, what, resolver](int fd) {
+					if (fd < 0) {
+						resolver->set_exception(std::make_exception_ptr(std::system_error(-fd, std::generic_category(), path)));
+						return;
+					}
+
+					_submit(opcode, fd, offset, buffer, size, [fd, settle = _settle(resolver, what)](int res) {
+						::close(fd);
+						settle(res);
+					});
+				});
+				return result;
+			}
+
+			void _read_next(std::shared_ptr<_whole_file> state) {
+				//the size may be unknown (or changing), keep a chunk of room past what was read
+				if (state->data.size() < state->filled + 4096)
+					state->data.resize(state->filled + 65536);
+
+				_submit(IORING_OP_READ, state->fd, state->filled, &state->data[state->filled], state->data.size() - state->filled,
+					[this, state](int res) {
+						if (res < 0) {
+							state->resolver.set_exception(std::make_exception_ptr(std::system_error(-res, std::generic_category(), "read_file")));
+							return;
+						}
+						if (res == 0) {
+							state->data.resize(state->filled);
+							state->resolver.set_value(std::move(state->data));
+							return;
+						}
+
+						state->filled += static_cast<size_t>(res);
+						_read_next(state);
+					});
+			}
+
+			backend used;
+			std::unique_ptr<detail::_uring> ring;
+			std::unique_ptr<executor> pool;
+
+			//open batches per thread, the counter spares the lock while there are none
+			std::atomic<unsigned int> batches;
+			std::mutex batch_mutex;
+			std::unordered_map<std::thread::id, unsigned int> batch_depth;
+		};
+
+		class batch
+		{
+		public:
+			explicit batch(file_service& service = file_service::shared()) : service(service) {
+				service._begin_batch();
+			}
+
+			batch(const batch&) = delete;
+			batch& operator=(const batch&) = delete;
+
+			~batch() {
+				if (service._end_batch() && service.ring)
+					service.ring->flush();
+			}
+
+		private:
+			file_service& service;
+		};
+
+		inline promise<size_t> read(int fd, uint64_t offset, void* buffer, size_t size) {
+			return file_service::shared().read(fd, offset, buffer, size);
+		}
+
+		inline promise<size_t> read(const std::string& path, uint64_t offset, void* buffer, size_t size) {
+			return file_service::shared().read(path, offset, buffer, size);
+		}
+
+		inline promise<size_t> write(int fd, uint64_t offset, const void* buffer, size_t size) {
+			return file_service::shared().write(fd, offset, buffer, size);
+		}
+
+		inline promise<size_t> write(const std::string& path, uint64_t offset, const void* buffer, size_t size) {
+			return file_service::shared().write(path, offset, buffer, size);
+		}
+
+		inline promise<std::string> read_file(const std::string& path) {
+			return file_service::shared().read_file(path);
+		}
+	}
+}
+
+#endif //__linux__
+
+#endif //IO_FILE_INCLUDED
\ No newline at end of file
@@ -0,0 +1,291 @@
+#pragma once
+#ifndef IO_IPC_INCLUDED
+#define IO_IPC_INCLUDED
+
+#ifdef __linux__
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <system_error>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "./../promise.h"
+
+namespace pro
+{
+	namespace ipc
+	{
+		namespace detail
+		{
+			enum _shared_state : uint32_t {
+				_pending = 0,
+				_settling,
+				_fulfilled,
+				_rejected,
+				_failed,
+				//the settling process died before it stored the outcome
+				_abandoned
+			};
+
+			//the state word holds the state in its low bits and, while settling, the pid of the settler above them
+			constexpr uint32_t _state_bits = 3;
+			constexpr uint32_t _state_mask = (1u << _state_bits) - 1;
+			//how often a waiter checks on a settler which takes unusually long
+			constexpr long _settler_check_ns = 100000000;
+
+			//layout of the shared memory segment, all zeros is a pending promise
+			template<typename T>
+			struct _segment {
+				std::atomic<uint32_t> state;
+				std::atomic<uint32_t> waiters;
+				alignas(T) unsigned char value[sizeof(T)];
+				char message[256];
+			};
+
+			//one mapping of a segment, unmapped by the last handle or consumer of this process
+			template<typename T>
+			class _mapping
+			{
+			public:
+				_mapping(const std::string& name, bool create) {
+					int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0600);
+					if (fd < 0)
+						throw std::system_error(errno, std::generic_category(), name);
+
+					//a fresh segment is zero-filled, which is already a valid pending state
+					struct stat info;
+					if ((create && ::ftruncate(fd, sizeof(_segment<T>)) < 0) || ::fstat(fd, &info) < 0) {
+						int error = errno;
+						::close(fd);
+						throw std::system_error(error, std::generic_category(), name);
+					}
+					if (static_cast<size_t>(info.st_size) < sizeof(_segment<T>)) {
+						::close(fd);
+						throw std::system_error(EINVAL, std::generic_category(), name + " is not a shared promise of this type");
+					}
+
+					void* address = ::mmap(nullptr, sizeof(_segment<T>), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+					int error = errno;
+					::close(fd);
+					if (address == MAP_FAILED)
+						throw std::system_error(error, std::generic_category(), name);
+					segment = static_cast<_segment<T>*>(address);
+				}
+
+				_mapping(const _mapping&) = delete;
+				_mapping& operator=(const _mapping&) = delete;
+
+				~_mapping() {
+					::munmap(segment, sizeof(_segment<T>));
+				}
+
+				//false if it was settled already
+				bool settle(uint32_t outcome, const T* value, const char* message) {
+					uint32_t expected = _pending;
+					uint32_t settling = _settling | (static_cast<uint32_t>(::getpid()) << _state_bits);
+					if (false == segment->state.compare_exchange_strong(expected, settling))
+						return false;
+
+					if (value)
+						std::memcpy(segment->value, value, sizeof(T));
+					if (message) {
+						std::strncpy(segment->message, message, sizeof(segment->message) - 1);
+						segment->message[sizeof(segment->message) - 1] = '\0';
+					}
+
+					segment->state.store(outcome);
+					if (segment->waiters.load() > 0)
+						_futex(FUTEX_WAKE, INT_MAX, nullptr);
+					return true;
+				}
+
+				/*
+				The settled state; blocks while another process is settling it. A settler
+				which died half way is noticed by its pid and the state becomes _abandoned.
+				*/
+				uint32_t wait() {
+					uint32_t current = segment->state.load(std::memory_order_acquire);
+					if ((current & _state_mask) >= _fulfilled)
+						return current & _state_mask;
+
+					segment->waiters.fetch_add(1);
+					while (((current = segment->state.load()) & _state_mask) < _fulfilled) {
+						if ((current & _state_mask) != _settling) {
+							_futex(FUTEX_WAIT, current, nullptr);
+							continue;
+						}
+
+						timespec timeout{ 0, _settler_check_ns };
+						if (_futex(FUTEX_WAIT, current, &timeout) < 0 && errno == ETIMEDOUT
+							&& _died(static_cast<pid_t>(current >> _state_bits))
+							&& segment->state.compare_exchange_strong(current, _abandoned)) {
+							_futex(FUTEX_WAKE, INT_MAX, nullptr);
+						}
+					}
+					segment->waiters.fetch_sub(1);
+					return current & _state_mask;
+				}
+
+				uint32_t state() const {
+					return segment->state.load(std::memory_order_acquire) & _state_mask;
+				}
+
+				T value() const {
+					T result;
+					std::memcpy(&result, segment->value, sizeof(T));
+					return result;
+				}
+
+				std::string message() const {
+					return std::string(segment->message);
+				}
+
+			private:
+				//not FUTEX_PRIVATE - the waiters are in other processes
+				long _futex(int op, uint32_t value, const timespec* timeout) {
+					return ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&segment->state), op, value, timeout, nullptr, 0);
+				}
+
+				//pids are compared within one pid namespace; a zombie still counts as alive
+				static bool _died(pid_t pid) {
+					return ::kill(pid, 0) < 0 && errno == ESRCH;
+				}
+
+				_segment<T>* segment;
+			};
+		}
+
+		/*
+		A promise shared between processes of the same host. The state lives in a named
+		POSIX shared memory segment: any process which opened it may settle it once, and
+		settling wakes the waiters of every process through a futex on the state word.
+		Consumers get a local pro::promise<T>. Values are copied byte by byte, so T has to
+		be trivially copyable. The segment is removed when the handle which created it is
+		destroyed; processes which opened it keep their mapping.
+		*/
+		template<typename T>
+		class shared_promise
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "pro::ipc::shared_promise requires a trivially copyable type");
+			static_assert(std::atomic<uint32_t>::is_always_lock_free, "pro::ipc::shared_promise requires lock-free atomics");
+
+		public:
+			using value_type = T;
+
+			//fails with std::system_error (EEXIST) if the name is taken
+			static shared_promise create(const std::string& name) {
+				std::string path = _path(name);
+				return shared_promise(std::make_shared<detail::_mapping<T>>(path, true), path);
+			}
+
+			static shared_promise open(const std::string& name) {
+				return shared_promise(std::make_shared<detail::_mapping<T>>(_path(name), false), std::string());
+			}
+
+			/*
+			Removes a segment left behind, e.g. by a crashed process. A process dying between
+			starting to settle and storing the outcome would leave the waiters blocked: they
+			check the recorded pid of the settler (of the same pid namespace) every 100ms and
+			reject with std::runtime_error once it is gone. A promise nobody settles is
+			waited for as long as a regular one.
+			*/
+			static bool remove(const std::string& name) {
+				return ::shm_unlink(_path(name).c_str()) == 0;
+			}
+
+			shared_promise(shared_promise&& other) noexcept
+				: mapping(std::move(other.mapping)), owned(std::move(other.owned)) {
+				other.owned.clear();
+			}
+
+			shared_promise& operator=(shared_promise&& other) noexcept {
+				if (this != &other) {
+					_unlink();
+					mapping = std::move(other.mapping);
+					owned = std::move(other.owned);
+					other.owned.clear();
+				}
+				return *this;
+			}
+
+			shared_promise(const shared_promise&) = delete;
+			shared_promise& operator=(const shared_promise&) = delete;
+
+			~shared_promise() {
+				_unlink();
+			}
+
+			void set_value(const T& value) {
+				_settle(detail::_fulfilled, &value, nullptr);
+			}
+
+			//consumers reject with the thrown T, like a rejected promise<T>
+			void reject(const T& reason) {
+				_settle(detail::_rejected, &reason, nullptr);
+			}
+
+			//consumers fail with std::runtime_error(what)
+			void set_exception(const std::string& what) {
+				_settle(detail::_failed, nullptr, what.c_str());
+			}
+
+			//settles with the state of the segment, whichever process settled it
+			promise<T> get_promise() {
+				return promise<T>([mapping = mapping]() -> T {
+					uint32_t state = mapping->wait();
+					if (state == detail::_fulfilled)
+						return mapping->value();
+					if (state == detail::_rejected)
+						throw mapping->value();
+					if (state == detail::_abandoned)
+						throw std::runtime_error("the process settling the shared promise died");
+					throw std::runtime_error(mapping->message());
+				});
+			}
+
+			bool settled() const {
+				return mapping->state() >= detail::_fulfilled;
+			}
+
+		private:
+			shared_promise(std::shared_ptr<detail::_mapping<T>> mapping, std::string owned)
+				: mapping(std::move(mapping)), owned(std::move(owned)) {
+			}
+
+			void _settle(uint32_t outcome, const T* value, const char* message) {
+				if (false == mapping->settle(outcome, value, message))
+					throw std::future_error(std::future_errc::promise_already_satisfied);
+			}
+
+			void _unlink() {
+				if (false == owned.empty())
+					::shm_unlink(owned.c_str());
+			}
+
+			static std::string _path(const std::string& name) {
+				return name.empty() || name[0] != '/' ? "/" + name : name;
+			}
+
+			std::shared_ptr<detail::_mapping<T>> mapping;
+			//the name of a segment created by this handle
+			std::string owned;
+		};
+	}
+}
+
+#endif //__linux__
+
+#endif //IO_IPC_INCLUDED
\ No newline at end of file
@@ -0,0 +1,287 @@
+#pragma once
+#ifndef IO_POLLABLE_INCLUDED
+#define IO_POLLABLE_INCLUDED
+
+#ifdef __linux__
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <cerrno>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "./../promise.h"
+
+namespace pro
+{
+	namespace io
+	{
+		namespace detail
+		{
+			//an eventfd closed with its last owner
+			class _eventfd
+			{
+			public:
+				_eventfd() : fd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+					if (fd < 0)
+						throw std::system_error(errno, std::generic_category(), "eventfd");
+				}
+
+				_eventfd(const _eventfd&) = delete;
+				_eventfd& operator=(const _eventfd&) = delete;
+
+				~_eventfd() {
+					::close(fd);
+				}
+
+				void signal() {
+					::eventfd_write(fd, 1);
+				}
+
+				void drain() {
+					eventfd_t value;
+					::eventfd_read(fd, &value);
+				}
+
+				const int fd;
+			};
+
+			template<typename T>
+			void _forward(std::future<T>& from, std::promise<T>& to) {
+				try {
+					if constexpr (std::is_void<T>::value) {
+						from.get();
+						to.set_value();
+					}
+					else {
+						to.set_value(from.get());
+					}
+				}
+				catch (...) {
+					//a rejection is a thrown T, the exception_ptr carries it over as it is
+					to.set_exception(std::current_exception());
+				}
+			}
+
+			/*
+			std::future has no completion callback, and a promise built from one (executor,
+			channel, combinators) has no body of its own to signal from, so settlements are
+			observed by polling. One thread checks every watched future on each scan - O(pending)
+			work up to 20000 times a second while futures keep settling, backing off to 1000
+			times a second while none does - and exits when nothing is left to watch.
+			*/
+			class _waiter
+			{
+			public:
+				//true once the future settled and was handled
+				using poll_type = std::function<bool()>;
+
+				static _waiter& instance() {
+					static _waiter* instance_ = new _waiter();
+					return *instance_;
+				}
+
+				void watch(poll_type poll) {
+					std::lock_guard<std::mutex> lock(mutex);
+					added.push_back(std::move(poll));
+					if (running) {
+						cv.notify_one();
+						return;
+					}
+
+					running = true;
+					std::thread t(&_waiter::_run, this);
+					t.detach();
+				}
+
+			private:
+				_waiter() : running(false) {}
+
+				void _run() {
+					constexpr auto shortest = std::chrono::microseconds(50);
+					constexpr auto longest = std::chrono::milliseconds(1);
+
+					std::vector<poll_type> watched;
+					std::chrono::microseconds pause = shortest;
+					while (true) {
+						{
+							std::unique_lock<std::mutex> lock(mutex);
+							if (added.empty() && false == watched.empty())
+								cv.wait_for(lock, pause, [this] { return false == added.empty(); });
+
+							std::move(added.begin(), added.end(), std::back_inserter(watched));
+							added.clear();
+							if (watched.empty()) {
+								running = false;
+								return;
+							}
+						}
+
+						size_t before = watched.size();
+						watched.erase(std::remove_if(watched.begin(), watched.end(), [](poll_type& poll) { return poll(); }), watched.end());
+						pause = watched.size() < before ? shortest : std::min<std::chrono::microseconds>(pause * 2, longest);
+					}
+				}
+
+				std::mutex mutex;
+				std::condition_variable cv;
+				std::vector<poll_type> added;
+				bool running;
+			};
+
+			//settled(future) is called inline when it is ready already, otherwise from the waiter thread
+			template<typename T, typename Fn>
+			void _on_settled(std::future<T>&& future, Fn&& settled) {
+				if (future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+					settled(future);
+					return;
+				}
+
+				auto watched = std::make_shared<std::future<T>>(std::move(future));
+				_waiter::instance().watch([watched, settled = std::forward<Fn>(settled)]() mutable {
+					if (watched->wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+						return false;
+					settled(*watched);
+					return true;
+				});
+			}
+		}
+
+		/*
+		A promise an external event loop can wait for: native_handle() is an eventfd which
+		becomes readable once the promise settled (and stays readable until read). take()
+		returns the promise; taken after the eventfd signalled, .then() does not block.
+		Until it settles the promise is polled by the shared waiter thread, which adds up
+		to 1ms of latency.
+		*/
+		template<typename T>
+		class pollable
+		{
+		public:
+			explicit pollable(promise<T>&& source) : event(std::make_shared<detail::_eventfd>()) {
+				auto resolver = std::make_shared<std::promise<T>>();
+				forwarded = std::make_unique<promise<T>>(resolver->get_future());
+				settled = std::make_shared<std::atomic<bool>>(false);
+
+				detail::_on_settled(std::future<T>(source), [resolver, event = event, settled = settled](std::future<T>& future) {
+					detail::_forward(future, *resolver);
+					settled->store(true, std::memory_order_release);
+					event->signal();
+				});
+			}
+
+			pollable(pollable&&) = default;
+			pollable& operator=(pollable&&) = default;
+
+			int native_handle() const {
+				return event->fd;
+			}
+
+			bool ready() const {
+				return settled->load(std::memory_order_acquire);
+			}
+
+			//the forwarded promise, once
+			promise<T> take() {
+				if (false == bool(forwarded))
+					throw std::future_error(std::future_errc::future_already_retrieved);
+				promise<T> result = std::move(*forwarded);
+				forwarded.reset();
+				return result;
+			}
+
+		private:
+			std::shared_ptr<detail::_eventfd> event;
+			std::shared_ptr<std::atomic<bool>> settled;
+			std::unique_ptr<promise<T>> forwarded;
+		};
+
+		/*
+		Many promises signalling a single eventfd. A settled promise is put on a ready
+		list; when native_handle() is readable the event loop calls drain(), which hands
+		each settled promise to its callback on the calling thread. Pending promises are
+		polled by the shared waiter thread, like the one of a pollable.
+		*/
+		class completion_set
+		{
+		public:
+			completion_set() : state(std::make_shared<_state>()) {}
+
+			completion_set(const completion_set&) = delete;
+			completion_set& operator=(const completion_set&) = delete;
+
+			int native_handle() const {
+				return state->event.fd;
+			}
+
+			//callback(promise<T>) is called by drain() with the settled promise
+			template<typename T, typename Cb, typename = std::enable_if_t<std::is_invocable_v<Cb, promise<T>>>>
+			void add(promise<T>&& source, Cb&& callback) {
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					++state->pending;
+				}
+
+				detail::_on_settled(std::future<T>(source), [state = state, callback = std::forward<Cb>(callback)](std::future<T>& future) mutable {
+					auto settled = std::make_shared<std::future<T>>(std::move(future));
+					state->ready([settled, callback]() mutable {
+						callback(promise<T>(std::move(*settled)));
+					});
+				});
+			}
+
+			//runs the callbacks of the promises settled so far, returns how many
+			size_t drain() {
+				std::vector<std::function<void()>> completed;
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->event.drain();
+					completed.swap(state->completed);
+				}
+
+				for (auto& callback : completed)
+					callback();
+				return completed.size();
+			}
+
+			//added and not settled yet
+			size_t pending() const {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				return state->pending;
+			}
+
+		private:
+			//shared with the waiters, which may settle after the set is gone
+			struct _state {
+				void ready(std::function<void()> callback) {
+					std::lock_guard<std::mutex> lock(mutex);
+					--pending;
+					completed.push_back(std::move(callback));
+					//only the first completion of a batch has to wake the loop
+					if (completed.size() == 1)
+						event.signal();
+				}
+
+				detail::_eventfd event;
+				mutable std::mutex mutex;
+				size_t pending = 0;
+				std::vector<std::function<void()>> completed;
+			};
+
+			std::shared_ptr<_state> state;
+		};
+	}
+}
+
+#endif //__linux__
+
+#endif //IO_POLLABLE_INCLUDED
\ No newline at end of file
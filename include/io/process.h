@@ -0,0 +1,385 @@
+#pragma once
+#ifndef IO_PROCESS_INCLUDED
+#define IO_PROCESS_INCLUDED
+
+#ifdef __linux__
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <tuple>
+#include <system_error>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "./../promise.h"
+#include "./reactor.h"
+
+extern char** environ;
+
+namespace pro
+{
+	namespace process
+	{
+		struct options {
+			//inherited from the parent when empty
+			std::string working_directory;
+			//"NAME=value" entries, the parent's environment when empty
+			std::vector<std::string> environment;
+
+			bool capture_stdout = true;
+			bool capture_stderr = true;
+
+			//output chunks as they arrive; a stream with a callback is not collected in the result
+			std::function<void(const std::string&)> on_stdout;
+			std::function<void(const std::string&)> on_stderr;
+		};
+
+		struct result {
+			//-1 when the process was killed by a signal
+			int exit_code = -1;
+			int signal = 0;
+			std::string out;
+			std::string err;
+
+			bool success() const {
+				return signal == 0 && exit_code == 0;
+			}
+		};
+
+		namespace detail
+		{
+			//one spawned process, settled when it exited and its captured pipes are drained
+			struct _child {
+				_child(io::reactor& r, const options& opts) : r(r), opts(opts), remaining(1), settled(false) {}
+
+				void finish_part() {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (--remaining == 0 && false == settled) {
+						settled = true;
+						resolver.set_value(std::move(res));
+					}
+				}
+
+				void fail(int error, const char* what) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (false == settled) {
+						settled = true;
+						resolver.set_exception(std::make_exception_ptr(std::system_error(error, std::generic_category(), what)));
+					}
+				}
+
+				void exited(int status) {
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						if (WIFEXITED(status)) {
+							res.exit_code = WEXITSTATUS(status);
+						}
+						else if (WIFSIGNALED(status)) {
+							res.signal = WTERMSIG(status);
+						}
+					}
+					finish_part();
+				}
+
+				io::reactor& r;
+				options opts;
+				pid_t pid = -1;
+
+				std::mutex mutex;
+				int remaining;
+				bool settled;
+				result res;
+				std::promise<result> resolver;
+			};
+
+			/*
+			Fallback for kernels without pidfd_open: a SIGCHLD handler writes to a pipe read
+			by a single reaper thread, which waits for the registered children only. The
+			handler found installed before is called after it; an ignored SIGCHLD is not
+			ignored anymore, so other children have to be waited for.
+			*/
+			class _sigchld_watch
+			{
+			public:
+				//called with the wait status, or with the errno when the child cannot be waited for
+				using callback_type = std::function<void(int, int)>;
+
+				static _sigchld_watch& instance() {
+					static _sigchld_watch* instance_ = new _sigchld_watch();
+					return *instance_;
+				}
+
+				void add(pid_t pid, callback_type callback) {
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						children.emplace(pid, std::move(callback));
+					}
+					//it may have exited before it was registered
+					_reap();
+				}
+
+			private:
+				_sigchld_watch() {
+					int fds[2];
+					if (::pipe2(fds, O_CLOEXEC) < 0)
+						throw std::system_error(errno, std::generic_category(), "pipe2");
+					read_fd = fds[0];
+					_write_fd() = fds[1];
+					::fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+					struct sigaction action {};
+					action.sa_sigaction = &_sigchld_watch::_on_signal;
+					action.sa_flags = SA_RESTART | SA_SIGINFO | SA_NOCLDSTOP;
+					sigemptyset(&action.sa_mask);
+					//the previous handler is chained, it keeps getting the stops it asked for
+					::sigaction(SIGCHLD, nullptr, &_previous());
+					if (_chains() && 0 == (_previous().sa_flags & SA_NOCLDSTOP))
+						action.sa_flags &= ~SA_NOCLDSTOP;
+					::sigaction(SIGCHLD, &action, nullptr);
+
+					std::thread reaper([this] {
+						char buffer[64];
+						while (::read(read_fd, buffer, sizeof(buffer)) > 0 || errno == EINTR)
+							_reap();
+					});
+					reaper.detach();
+				}
+
+				static int& _write_fd() {
+					static int fd = -1;
+					return fd;
+				}
+
+				static struct sigaction& _previous() {
+					static struct sigaction action {};
+					return action;
+				}
+
+				static bool _chains() {
+					const struct sigaction& previous = _previous();
+					return (previous.sa_flags & SA_SIGINFO)
+						|| (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN);
+				}
+
+				static void _on_signal(int signal, siginfo_t* info, void* context) {
+					int saved = errno;
+					char signaled = 1;
+					if (::write(_write_fd(), &signaled, 1) < 0) {
+						//the pipe is full, the reaper is woken already
+					}
+					errno = saved;
+
+					const struct sigaction& previous = _previous();
+					if (previous.sa_flags & SA_SIGINFO)
+						previous.sa_sigaction(signal, info, context);
+					else if (_chains())
+						previous.sa_handler(signal);
+				}
+
+				void _reap() {
+					std::vector<std::tuple<callback_type, int, int>> reaped;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						for (auto it = children.begin(); it != children.end();) {
+							int status = 0;
+							pid_t waited = ::waitpid(it->first, &status, WNOHANG);
+							//ECHILD: reaped by someone else, e.g. a chained handler waiting for any child
+							if (waited == it->first || (waited < 0 && errno == ECHILD)) {
+								reaped.emplace_back(std::move(it->second), status, waited < 0 ? ECHILD : 0);
+								it = children.erase(it);
+							}
+							else {
+								++it;
+							}
+						}
+					}
+
+					for (auto& child : reaped)
+						std::get<0>(child)(std::get<1>(child), std::get<2>(child));
+				}
+
+				int read_fd;
+				std::mutex mutex;
+				std::unordered_map<pid_t, callback_type> children;
+			};
+
+			inline void _drain(std::shared_ptr<_child> child, int fd, bool is_stderr) {
+				child->r.watch(fd, EPOLLIN, [child, fd, is_stderr](uint32_t revents) {
+					if (revents == io::reactor::forgotten) {
+						::close(fd);
+						child->fail(ECANCELED, "process");
+						return;
+					}
+
+					const auto& stream = is_stderr ? child->opts.on_stderr : child->opts.on_stdout;
+					char buffer[4096];
+					while (true) {
+						ssize_t n = ::read(fd, buffer, sizeof(buffer));
+						if (n > 0) {
+							if (stream) {
+								stream(std::string(buffer, static_cast<size_t>(n)));
+							}
+							else {
+								std::lock_guard<std::mutex> lock(child->mutex);
+								(is_stderr ? child->res.err : child->res.out).append(buffer, static_cast<size_t>(n));
+							}
+							continue;
+						}
+						if (n < 0 && errno == EINTR)
+							continue;
+						if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+							_drain(child, fd, is_stderr);
+							return;
+						}
+
+						//end of the stream, or the pipe failed - either way nothing more to read
+						child->r.forget(fd);
+						::close(fd);
+						child->finish_part();
+						return;
+					}
+				});
+			}
+
+			inline void _wait_exit(std::shared_ptr<_child> child) {
+				int pidfd = static_cast<int>(::syscall(SYS_pidfd_open, child->pid, 0));
+				if (pidfd < 0 && errno != ENOSYS) {
+					//ESRCH when the child was reaped already, e.g. with SIGCHLD ignored
+					child->fail(errno, "pidfd_open");
+					return;
+				}
+				if (pidfd < 0) {
+					_sigchld_watch::instance().add(child->pid, [child](int status, int error) {
+						if (error != 0)
+							child->fail(error, "waitpid");
+						else
+							child->exited(status);
+					});
+					return;
+				}
+
+				child->r.watch(pidfd, EPOLLIN, [child, pidfd](uint32_t revents) {
+					if (revents == io::reactor::forgotten) {
+						::close(pidfd);
+						child->fail(ECANCELED, "process");
+						return;
+					}
+
+					int status = 0;
+					pid_t waited;
+					while ((waited = ::waitpid(child->pid, &status, 0)) < 0 && errno == EINTR) {}
+					int error = waited < 0 ? errno : 0;
+					child->r.forget(pidfd);
+					::close(pidfd);
+					if (error != 0)
+						child->fail(error, "waitpid");
+					else
+						child->exited(status);
+				});
+			}
+
+			inline void _close_pipe(int fds[2]) {
+				if (fds[0] >= 0)
+					::close(fds[0]);
+				if (fds[1] >= 0)
+					::close(fds[1]);
+			}
+		}
+
+		/*
+		Starts argv[0] (looked up in PATH) and fulfills with its exit status and captured
+		output once it exited and closed its output. No thread is held per child: the output
+		pipes and the exit (a pidfd) are watched by the reactor; on kernels without pidfd_open
+		one shared thread reaps the children on SIGCHLD. A program which cannot be started
+		rejects the promise with std::system_error.
+		*/
+		inline promise<result> spawn(const std::vector<std::string>& argv, const options& opts = options(), io::reactor& r = io::reactor::shared()) {
+			if (argv.empty())
+				return promise<result>(std::make_exception_ptr(std::invalid_argument("spawn requires a program")));
+
+			auto child = std::make_shared<detail::_child>(r, opts);
+			promise<result> settled(child->resolver.get_future());
+
+			int out[2] = { -1, -1 };
+			int err[2] = { -1, -1 };
+			if ((opts.capture_stdout && ::pipe2(out, O_CLOEXEC) < 0) || (opts.capture_stderr && ::pipe2(err, O_CLOEXEC) < 0)) {
+				int error = errno;
+				detail::_close_pipe(out);
+				return promise<result>(std::make_exception_ptr(std::system_error(error, std::generic_category(), "pipe2")));
+			}
+
+			posix_spawn_file_actions_t actions;
+			posix_spawn_file_actions_init(&actions);
+			posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+			if (opts.capture_stdout)
+				posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+			if (opts.capture_stderr)
+				posix_spawn_file_actions_adddup2(&actions, err[1], STDERR_FILENO);
+			if (false == opts.working_directory.empty())
+				posix_spawn_file_actions_addchdir_np(&actions, opts.working_directory.c_str());
+
+			//signals blocked by the calling thread are not passed on to the child
+			posix_spawnattr_t attributes;
+			posix_spawnattr_init(&attributes);
+			sigset_t mask;
+			sigemptyset(&mask);
+			posix_spawnattr_setsigmask(&attributes, &mask);
+			posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK);
+
+			std::vector<char*> args;
+			for (auto& arg : argv)
+				args.push_back(const_cast<char*>(arg.c_str()));
+			args.push_back(nullptr);
+
+			std::vector<char*> env;
+			for (auto& variable : opts.environment)
+				env.push_back(const_cast<char*>(variable.c_str()));
+			env.push_back(nullptr);
+
+			int error = ::posix_spawnp(&child->pid, args[0], &actions, &attributes, args.data(), opts.environment.empty() ? environ : env.data());
+			posix_spawnattr_destroy(&attributes);
+			posix_spawn_file_actions_destroy(&actions);
+
+			//the child has its own copies of the write ends
+			if (out[1] >= 0)
+				::close(out[1]);
+			if (err[1] >= 0)
+				::close(err[1]);
+
+			if (error != 0) {
+				if (out[0] >= 0)
+					::close(out[0]);
+				if (err[0] >= 0)
+					::close(err[0]);
+				return promise<result>(std::make_exception_ptr(std::system_error(error, std::generic_category(), argv[0])));
+			}
+
+			child->remaining += (opts.capture_stdout ? 1 : 0) + (opts.capture_stderr ? 1 : 0);
+			if (opts.capture_stdout) {
+				::fcntl(out[0], F_SETFL, O_NONBLOCK);
+				detail::_drain(child, out[0], false);
+			}
+			if (opts.capture_stderr) {
+				::fcntl(err[0], F_SETFL, O_NONBLOCK);
+				detail::_drain(child, err[0], true);
+			}
+			detail::_wait_exit(child);
+
+			return settled;
+		}
+	}
+}
+
+#endif //__linux__
+
+#endif //IO_PROCESS_INCLUDED
\ No newline at end of file
@@ -0,0 +1,315 @@
+#pragma once
+#ifndef IO_REACTOR_INCLUDED
+#define IO_REACTOR_INCLUDED
+
+#ifdef __linux__
+
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <system_error>
+#include <thread>
+#include <mutex>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "./../promise.h"
+#include "./../executor.h"
+
+namespace pro
+{
+	namespace io
+	{
+		/*
+		One epoll thread waiting for every registered file descriptor. Readiness is
+		reported through promises and the callbacks run on the executor, never on the
+		reactor thread. Descriptors are expected to be non-blocking; call forget(fd)
+		before closing one with waiters left.
+		*/
+		class reactor
+		{
+		public:
+			using callback_type = std::function<void(uint32_t)>;
+
+			//passed instead of the epoll events to waiters of a forgotten descriptor
+			static constexpr uint32_t forgotten = 0;
+
+			explicit reactor(executor& ex = executor::shared())
+				: ex(ex), stopping(false) {
+				epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+				if (epoll_fd < 0)
+					throw std::system_error(errno, std::generic_category(), "epoll_create1");
+
+				wake_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+				if (wake_fd < 0) {
+					int error = errno;
+					::close(epoll_fd);
+					throw std::system_error(error, std::generic_category(), "eventfd");
+				}
+
+				epoll_event event{};
+				event.events = EPOLLIN;
+				event.data.fd = wake_fd;
+				::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+
+				worker = std::thread(&reactor::run, this);
+			}
+
+			reactor(const reactor&) = delete;
+			reactor& operator=(const reactor&) = delete;
+
+			//pending waiters are called with 'forgotten'
+			~reactor() {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stopping = true;
+				}
+				_wake();
+				worker.join();
+
+				for (auto& entry : entries) {
+					for (auto& callback : entry.second.readers)
+						callback(forgotten);
+					for (auto& callback : entry.second.writers)
+						callback(forgotten);
+				}
+				::close(wake_fd);
+				::close(epoll_fd);
+			}
+
+			static reactor& shared() {
+				static reactor instance_;
+				return instance_;
+			}
+
+			//calls back once on the executor when fd is readable (EPOLLIN) or writable (EPOLLOUT)
+			void watch(int fd, uint32_t events, callback_type callback) {
+				std::lock_guard<std::mutex> lock(mutex);
+				_entry& entry = entries[fd];
+				if (events & EPOLLIN)
+					entry.readers.push_back(std::move(callback));
+				else
+					entry.writers.push_back(std::move(callback));
+				_arm(fd, entry);
+			}
+
+			promise<void> readable(int fd) {
+				return _ready(fd, EPOLLIN);
+			}
+
+			promise<void> writable(int fd) {
+				return _ready(fd, EPOLLOUT);
+			}
+
+			//reads what is available once fd is readable, 0 at the end of the stream
+			promise<size_t> read(int fd, void* buffer, size_t size) {
+				auto resolver = std::make_shared<std::promise<size_t>>();
+				promise<size_t> result(resolver->get_future());
+				_read(fd, buffer, size, resolver);
+				return result;
+			}
+
+			//writes what fits once fd is writable, possibly less than size
+			promise<size_t> write(int fd, const void* buffer, size_t size) {
+				auto resolver = std::make_shared<std::promise<size_t>>();
+				promise<size_t> result(resolver->get_future());
+				_write(fd, buffer, size, resolver);
+				return result;
+			}
+
+			//drops fd from the reactor, its waiters are called with 'forgotten'
+			void forget(int fd) {
+				_entry entry;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					auto it = entries.find(fd);
+					if (it == entries.end())
+						return;
+
+					entry = std::move(it->second);
+					entries.erase(it);
+					if (entry.registered)
+						::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+				}
+
+				_dispatch(entry.readers, forgotten);
+				_dispatch(entry.writers, forgotten);
+			}
+
+			size_t watched() {
+				std::lock_guard<std::mutex> lock(mutex);
+				size_t count = 0;
+				for (auto& entry : entries)
+					count += entry.second.readers.size() + entry.second.writers.size();
+				return count;
+			}
+
+			executor& get_executor() {
+				return ex;
+			}
+
+		private:
+			struct _entry {
+				std::deque<callback_type> readers;
+				std::deque<callback_type> writers;
+				bool registered = false;
+			};
+
+			//one-shot interest in what the waiters need, re-armed after every event
+			void _arm(int fd, _entry& entry) {
+				epoll_event event{};
+				event.events = EPOLLONESHOT;
+				if (false == entry.readers.empty())
+					event.events |= EPOLLIN | EPOLLRDHUP;
+				if (false == entry.writers.empty())
+					event.events |= EPOLLOUT;
+				event.data.fd = fd;
+
+				//a descriptor closed without forget() left epoll, its number may be back as a new one
+				if (entry.registered && ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0)
+					return;
+
+				if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0
+					|| (errno == EEXIST && ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0)) {
+					entry.registered = true;
+				}
+				else {
+					//not pollable (e.g. a regular file) - it never blocks, report it ready
+					std::deque<callback_type> ready;
+					ready.swap(entry.readers);
+					for (auto& callback : entry.writers)
+						ready.push_back(std::move(callback));
+					entry.writers.clear();
+					_dispatch(ready, EPOLLIN | EPOLLOUT);
+				}
+			}
+
+			void run() {
+				std::vector<epoll_event> events(64);
+				while (true) {
+					int count = ::epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+					if (count < 0 && errno != EINTR)
+						return;
+
+					for (int i = 0; i < count; ++i) {
+						if (events[i].data.fd == wake_fd) {
+							eventfd_t value;
+							::eventfd_read(wake_fd, &value);
+							continue;
+						}
+						_ready_event(events[i].data.fd, events[i].events);
+					}
+
+					std::lock_guard<std::mutex> lock(mutex);
+					if (stopping)
+						return;
+				}
+			}
+
+			void _ready_event(int fd, uint32_t revents) {
+				std::deque<callback_type> readers;
+				std::deque<callback_type> writers;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					auto it = entries.find(fd);
+					if (it == entries.end())
+						return;
+
+					_entry& entry = it->second;
+					bool failed = revents & (EPOLLERR | EPOLLHUP);
+					if (failed || (revents & (EPOLLIN | EPOLLRDHUP)))
+						readers.swap(entry.readers);
+					if (failed || (revents & EPOLLOUT))
+						writers.swap(entry.writers);
+
+					if (false == entry.readers.empty() || false == entry.writers.empty())
+						_arm(fd, entry);
+				}
+
+				_dispatch(readers, revents);
+				_dispatch(writers, revents);
+			}
+
+			void _dispatch(std::deque<callback_type>& callbacks, uint32_t revents) {
+				for (auto& callback : callbacks)
+					ex.submit([callback = std::move(callback), revents] { callback(revents); });
+			}
+
+			void _wake() {
+				::eventfd_write(wake_fd, 1);
+			}
+
+			promise<void> _ready(int fd, uint32_t events) {
+				auto resolver = std::make_shared<std::promise<void>>();
+				promise<void> result(resolver->get_future());
+				watch(fd, events, [resolver](uint32_t revents) {
+					if (revents == forgotten)
+						resolver->set_exception(std::make_exception_ptr(std::system_error(ECANCELED, std::generic_category(), "reactor")));
+					else
+						resolver->set_value();
+				});
+				return result;
+			}
+
+			void _read(int fd, void* buffer, size_t size, std::shared_ptr<std::promise<size_t>> resolver) {
+				ssize_t n;
+				do {
+					n = ::read(fd, buffer, size);
+				} while (n < 0 && errno == EINTR);
+
+				if (n >= 0) {
+					resolver->set_value(static_cast<size_t>(n));
+					return;
+				}
+				if (errno != EAGAIN && errno != EWOULDBLOCK) {
+					resolver->set_exception(std::make_exception_ptr(std::system_error(errno, std::generic_category(), "read")));
+					return;
+				}
+
+				watch(fd, EPOLLIN, [this, fd, buffer, size, resolver](uint32_t revents) {
+					if (revents == forgotten)
+						resolver->set_exception(std::make_exception_ptr(std::system_error(ECANCELED, std::generic_category(), "read")));
+					else
+						_read(fd, buffer, size, resolver);
+				});
+			}
+
+			void _write(int fd, const void* buffer, size_t size, std::shared_ptr<std::promise<size_t>> resolver) {
+				ssize_t n;
+				do {
+					n = ::write(fd, buffer, size);
+				} while (n < 0 && errno == EINTR);
+
+				if (n >= 0) {
+					resolver->set_value(static_cast<size_t>(n));
+					return;
+				}
+				if (errno != EAGAIN && errno != EWOULDBLOCK) {
+					resolver->set_exception(std::make_exception_ptr(std::system_error(errno, std::generic_category(), "write")));
+					return;
+				}
+
+				watch(fd, EPOLLOUT, [this, fd, buffer, size, resolver](uint32_t revents) {
+					if (revents == forgotten)
+						resolver->set_exception(std::make_exception_ptr(std::system_error(ECANCELED, std::generic_category(), "write")));
+					else
+						_write(fd, buffer, size, resolver);
+				});
+			}
+
+			executor& ex;
+			int epoll_fd;
+			int wake_fd;
+
+			std::mutex mutex;
+			bool stopping;
+			std::unordered_map<int, _entry> entries;
+			std::thread worker;
+		};
+	}
+}
+
+#endif //__linux__
+
+#endif //IO_REACTOR_INCLUDED
\ No newline at end of file
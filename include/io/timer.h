@@ -0,0 +1,428 @@
+#pragma once
+#ifndef IO_TIMER_INCLUDED
+#define IO_TIMER_INCLUDED
+
+#ifdef __linux__
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <system_error>
+#include <mutex>
+#include <limits>
+#include <cstdint>
+#include <cerrno>
+#include <time.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "./../promise.h"
+#include "./reactor.h"
+
+namespace pro
+{
+	namespace io
+	{
+		namespace detail
+		{
+			/*
+			Hierarchical timing wheel: 4 levels of 256 slots, level l counting in steps of
+			256^l ticks. Timers live in a node pool linked into their slot, so inserting and
+			cancelling are O(1) and a cancelled node is reused right away. Timers of a higher
+			level cascade down when the wheel reaches their slot. Not synchronized.
+			*/
+			class _timer_wheel
+			{
+			public:
+				using callback_type = std::function<void(bool)>;
+
+				static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+				static constexpr unsigned int levels = 4;
+				static constexpr unsigned int slots = 256;
+
+				_timer_wheel() : current(0), free_head(npos), count(0) {
+					heads.fill(npos);
+					for (auto& level : bits)
+						level.fill(0);
+				}
+
+				//index of the new timer; a deadline already reached expires with the next tick
+				uint32_t insert(uint64_t deadline, callback_type callback) {
+					uint32_t index;
+					if (free_head != npos) {
+						index = free_head;
+						free_head = nodes[index].next;
+					}
+					else {
+						index = static_cast<uint32_t>(nodes.size());
+						nodes.emplace_back();
+					}
+
+					_node& node = nodes[index];
+					node.deadline = std::max(deadline, current + 1);
+					node.callback = std::move(callback);
+					_place(index);
+					++count;
+					return index;
+				}
+
+				bool is_live(uint32_t index, uint32_t generation) const {
+					return index < nodes.size() && nodes[index].generation == generation && nodes[index].callback;
+				}
+
+				uint32_t generation(uint32_t index) const {
+					return nodes[index].generation;
+				}
+
+				callback_type remove(uint32_t index) {
+					_unlink(index);
+					return _release(index);
+				}
+
+				//runs the wheel up to 'now', collecting the callbacks of the expired timers
+				void advance(uint64_t now, std::vector<callback_type>& expired) {
+					while (count > 0) {
+						uint64_t tick = next_tick();
+						if (tick > now)
+							break;
+
+						current = tick;
+						//higher levels first, their timers may cascade down to this very tick
+						for (unsigned int level = levels - 1; level > 0; --level) {
+							if ((tick & ((uint64_t(1) << (8 * level)) - 1)) == 0)
+								_cascade(level, (tick >> (8 * level)) & (slots - 1), expired);
+						}
+						_expire_slot(tick & (slots - 1), expired);
+					}
+					current = std::max(current, now);
+				}
+
+				//the tick at which the wheel has something to do, max() when empty
+				uint64_t next_tick() const {
+					uint64_t next = std::numeric_limits<uint64_t>::max();
+					for (unsigned int level = 0; level < levels; ++level) {
+						uint64_t base = (current >> (8 * level)) + 1;
+						unsigned int from = base & (slots - 1);
+						int slot = _find(bits[level], from);
+						if (slot < 0)
+							continue;
+
+						uint64_t offset = (static_cast<unsigned int>(slot) - from) & (slots - 1);
+						next = std::min(next, (base + offset) << (8 * level));
+					}
+					return next;
+				}
+
+				//catches up with the clock if nothing is pending, the skipped ticks were empty
+				void sync(uint64_t now) {
+					if (count == 0)
+						current = std::max(current, now);
+				}
+
+				size_t size() const {
+					return count;
+				}
+
+				std::vector<callback_type> clear() {
+					std::vector<callback_type> callbacks;
+					for (uint32_t index = 0; index < nodes.size(); ++index) {
+						if (nodes[index].callback)
+							callbacks.push_back(remove(index));
+					}
+					return callbacks;
+				}
+
+			private:
+				struct _node {
+					uint64_t deadline = 0;
+					uint32_t prev = npos;
+					uint32_t next = npos;
+					uint32_t generation = 0;
+					uint16_t slot = 0;
+					callback_type callback;
+				};
+
+				void _place(uint32_t index) {
+					_node& node = nodes[index];
+					uint64_t delta = node.deadline - current;
+					unsigned int level = 0;
+					while (level < levels - 1 && delta >= (uint64_t(1) << (8 * (level + 1))))
+						++level;
+
+					//beyond the wheel - parked in the farthest slot, placed again when it cascades
+					uint64_t deadline = delta >= (uint64_t(1) << (8 * levels)) ? current + (uint64_t(1) << (8 * levels)) - 1 : node.deadline;
+					unsigned int slot = (deadline >> (8 * level)) & (slots - 1);
+
+					node.slot = static_cast<uint16_t>(level * slots + slot);
+					node.prev = npos;
+					node.next = heads[node.slot];
+					if (node.next != npos)
+						nodes[node.next].prev = index;
+					heads[node.slot] = index;
+					bits[level][slot >> 6] |= uint64_t(1) << (slot & 63);
+				}
+
+				void _unlink(uint32_t index) {
+					_node& node = nodes[index];
+					if (node.prev != npos)
+						nodes[node.prev].next = node.next;
+					else
+						heads[node.slot] = node.next;
+					if (node.next != npos)
+						nodes[node.next].prev = node.prev;
+
+					if (heads[node.slot] == npos) {
+						unsigned int level = node.slot / slots;
+						unsigned int slot = node.slot % slots;
+						bits[level][slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+					}
+				}
+
+				callback_type _release(uint32_t index) {
+					_node& node = nodes[index];
+					callback_type callback = std::move(node.callback);
+					node.callback = nullptr;
+					++node.generation;
+					node.next = free_head;
+					free_head = index;
+					--count;
+					return callback;
+				}
+
+				uint32_t _take_slot(unsigned int level, unsigned int slot) {
+					uint32_t head = heads[level * slots + slot];
+					heads[level * slots + slot] = npos;
+					bits[level][slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+					return head;
+				}
+
+				void _cascade(unsigned int level, unsigned int slot, std::vector<callback_type>& expired) {
+					for (uint32_t index = _take_slot(level, slot); index != npos;) {
+						uint32_t next = nodes[index].next;
+						if (nodes[index].deadline <= current)
+							expired.push_back(_release(index));
+						else
+							_place(index);
+						index = next;
+					}
+				}
+
+				void _expire_slot(unsigned int slot, std::vector<callback_type>& expired) {
+					for (uint32_t index = _take_slot(0, slot); index != npos;) {
+						uint32_t next = nodes[index].next;
+						expired.push_back(_release(index));
+						index = next;
+					}
+				}
+
+				//first set bit at or after 'from', wrapping around the level
+				static int _find(const std::array<uint64_t, slots / 64>& words, unsigned int from) {
+					for (unsigned int i = 0; i <= words.size(); ++i) {
+						unsigned int word = ((from >> 6) + i) % words.size();
+						uint64_t mask = words[word];
+						if (i == 0)
+							mask &= ~uint64_t(0) << (from & 63);
+						else if (i == words.size())
+							mask &= (uint64_t(1) << (from & 63)) - 1;
+						if (mask)
+							return static_cast<int>(word * 64 + __builtin_ctzll(mask));
+					}
+					return -1;
+				}
+
+				uint64_t current;
+				std::vector<_node> nodes;
+				uint32_t free_head;
+				size_t count;
+				std::array<uint32_t, levels * slots> heads;
+				std::array<std::array<uint64_t, slots / 64>, levels> bits;
+			};
+		}
+
+		/*
+		Timers multiplexed onto a single timerfd watched by the reactor. Each timer is a
+		node of a timing wheel, so scheduling and cancelling cost the same with a million
+		of them pending, and the timerfd is armed only for the next tick with work to do.
+		Callbacks run on the reactor's executor.
+		*/
+		class timer_queue
+		{
+		public:
+			using duration = std::chrono::nanoseconds;
+			//0 is never a valid id
+			using timer_id = uint64_t;
+
+			explicit timer_queue(reactor& r = reactor::shared(), duration tick = std::chrono::milliseconds(1))
+				: state(std::make_shared<_state>(r, tick)) {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->watch();
+			}
+
+			timer_queue(const timer_queue&) = delete;
+			timer_queue& operator=(const timer_queue&) = delete;
+
+			//pending timers are cancelled
+			~timer_queue() {
+				std::vector<detail::_timer_wheel::callback_type> cancelled;
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->stopping = true;
+					cancelled = state->wheel.clear();
+				}
+				state->r.forget(state->fd);
+
+				for (auto& callback : cancelled)
+					callback(false);
+			}
+
+			static timer_queue& shared() {
+				static timer_queue instance_;
+				return instance_;
+			}
+
+			//calls back once, not sooner than 'after' from now
+			timer_id schedule(duration after, std::function<void()> callback) {
+				return state->schedule(after, [callback = std::move(callback)](bool fired) {
+					if (fired)
+						callback();
+				});
+			}
+
+			promise<void> delay(duration after) {
+				timer_id id;
+				return delay(after, id);
+			}
+
+			//cancelling 'id' rejects the promise with std::system_error (ECANCELED)
+			promise<void> delay(duration after, timer_id& id) {
+				auto resolver = std::make_shared<std::promise<void>>();
+				promise<void> result(resolver->get_future());
+				id = state->schedule(after, [resolver](bool fired) {
+					if (fired)
+						resolver->set_value();
+					else
+						resolver->set_exception(std::make_exception_ptr(std::system_error(ECANCELED, std::generic_category(), "timer")));
+				});
+				return result;
+			}
+
+			//false if the timer already fired or was cancelled
+			bool cancel(timer_id id) {
+				uint32_t index = static_cast<uint32_t>(id & 0xffffffff) - 1;
+				uint32_t generation = static_cast<uint32_t>(id >> 32);
+
+				detail::_timer_wheel::callback_type callback;
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if (id == 0 || false == state->wheel.is_live(index, generation))
+						return false;
+					callback = state->wheel.remove(index);
+				}
+				callback(false);
+				return true;
+			}
+
+			size_t pending() const {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				return state->wheel.size();
+			}
+
+		private:
+			//shared with the reactor callback, which may run after the queue is gone
+			struct _state : std::enable_shared_from_this<_state> {
+				_state(reactor& r, duration tick)
+					: r(r), tick_ns(std::max<int64_t>(tick.count(), 1)), armed(std::numeric_limits<uint64_t>::max()), stopping(false) {
+					fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+					if (fd < 0)
+						throw std::system_error(errno, std::generic_category(), "timerfd_create");
+					start_ns = _now_ns();
+				}
+
+				~_state() {
+					::close(fd);
+				}
+
+				timer_id schedule(duration after, detail::_timer_wheel::callback_type callback) {
+					int64_t due_ns = _now_ns() - start_ns + std::max<int64_t>(after.count(), 0);
+					uint64_t deadline = static_cast<uint64_t>((due_ns + tick_ns - 1) / tick_ns);
+
+					std::lock_guard<std::mutex> lock(mutex);
+					wheel.sync(_now_tick());
+					uint32_t index = wheel.insert(deadline, std::move(callback));
+
+					uint64_t next = wheel.next_tick();
+					if (next < armed)
+						_arm(next);
+					return (uint64_t(wheel.generation(index)) << 32) | (uint64_t(index) + 1);
+				}
+
+				void watch() {
+					r.watch(fd, EPOLLIN, [self = shared_from_this()](uint32_t revents) {
+						if (revents != reactor::forgotten)
+							self->expire();
+					});
+				}
+
+				void expire() {
+					std::vector<detail::_timer_wheel::callback_type> expired;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						if (stopping)
+							return;
+
+						uint64_t expirations;
+						while (::read(fd, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {}
+
+						wheel.advance(_now_tick(), expired);
+						armed = std::numeric_limits<uint64_t>::max();
+						uint64_t next = wheel.next_tick();
+						if (next != armed)
+							_arm(next);
+						watch();
+					}
+
+					for (auto& callback : expired)
+						callback(true);
+				}
+
+				void _arm(uint64_t tick) {
+					armed = tick;
+					int64_t at = start_ns + static_cast<int64_t>(tick) * tick_ns;
+
+					itimerspec spec{};
+					spec.it_value.tv_sec = at / 1000000000;
+					spec.it_value.tv_nsec = at % 1000000000;
+					::timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+				}
+
+				uint64_t _now_tick() const {
+					return static_cast<uint64_t>((_now_ns() - start_ns) / tick_ns);
+				}
+
+				static int64_t _now_ns() {
+					timespec now;
+					::clock_gettime(CLOCK_MONOTONIC, &now);
+					return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+				}
+
+				reactor& r;
+				int fd;
+				int64_t start_ns;
+				const int64_t tick_ns;
+
+				mutable std::mutex mutex;
+				detail::_timer_wheel wheel;
+				uint64_t armed;
+				bool stopping;
+			};
+
+			std::shared_ptr<_state> state;
+		};
+	}
+}
+
+#endif //__linux__
+
+#endif //IO_TIMER_INCLUDED
\ No newline at end of file
@@ -0,0 +1,383 @@
+#pragma once
+#ifndef PIPELINE_INCLUDED
+#define PIPELINE_INCLUDED
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <optional>
+#include "./promise.h"
+#include "./executor.h"
+#include "./utils/type_utils.h"
+
+namespace pro
+{
+	namespace detail
+	{
+		//state of one pipeline run, every node is driven under its mutex
+		struct _pipeline_run : std::enable_shared_from_this<_pipeline_run> {
+			explicit _pipeline_run(executor& ex) : ex(ex) {}
+
+			void fail(std::exception_ptr e) {
+				if (!eptr)
+					eptr = std::move(e);
+			}
+
+			bool failed() const {
+				return static_cast<bool>(eptr);
+			}
+
+			void complete() {
+				if (eptr)
+					resolver.set_exception(eptr);
+				else
+					resolver.set_value();
+			}
+
+			std::mutex mutex;
+			executor& ex;
+			std::exception_ptr eptr;
+			std::promise<void> resolver;
+
+			std::vector<std::shared_ptr<void>> nodes;
+			std::function<void()> start;
+		};
+
+		//receiving end of a node, called under the run mutex only
+		template<typename T>
+		struct _pipeline_input {
+			virtual ~_pipeline_input() = default;
+
+			virtual bool accepts() const = 0;
+			virtual void push(T&& item) = 0;
+			virtual void close() = 0;
+
+			//set by the upstream node, called when the queue has room again
+			std::function<void()> on_space;
+		};
+
+		/*
+		Stage running up to 'concurrency' items at once on the executor. Outputs not
+		accepted downstream are parked in the stage and count against its concurrency,
+		so a slow consumer stops its producers instead of growing the queues.
+		*/
+		template<typename In, typename Out>
+		class _pipeline_stage : public _pipeline_input<In> {
+		public:
+			using function_type = std::function<Out(In)>;
+
+			_pipeline_stage(_pipeline_run& run, function_type fn, unsigned int concurrency, size_t capacity,
+				_pipeline_input<Out>* downstream)
+				: run(run),
+				fn(std::move(fn)),
+				concurrency(std::max(1u, concurrency)),
+				capacity(std::max<size_t>(1, capacity)),
+				downstream(downstream),
+				active(0),
+				closed(false),
+				finished(false),
+				draining(false) {
+			}
+
+			bool accepts() const override {
+				return queue.size() < capacity;
+			}
+
+			void push(In&& item) override {
+				if (false == run.failed())
+					queue.push_back(std::move(item));
+				_schedule();
+			}
+
+			void close() override {
+				closed = true;
+				_try_finish();
+			}
+
+			//downstream room freed, parked outputs may go
+			void resume() {
+				_drain();
+				_schedule();
+			}
+
+		private:
+			void _schedule() {
+				bool freed = false;
+				if (run.failed() && false == queue.empty()) {
+					queue.clear();
+					freed = true;
+				}
+
+				while (false == queue.empty() && active + _parked() < concurrency) {
+					++active;
+					freed = true;
+					run.ex.submit([self = this, keep = run.shared_from_this(), item = std::move(queue.front())]() mutable {
+						self->_execute(std::move(item));
+					});
+					queue.pop_front();
+				}
+
+				if (freed && this->on_space)
+					this->on_space();
+				_try_finish();
+			}
+
+			void _execute(In item) {
+				std::exception_ptr eptr;
+				std::optional<_output_type> output;
+				try {
+					if constexpr (std::is_void<Out>::value) {
+						fn(std::move(item));
+					}
+					else {
+						output.emplace(fn(std::move(item)));
+					}
+				}
+				catch (...) {
+					eptr = std::current_exception();
+				}
+
+				std::lock_guard<std::mutex> lock(run.mutex);
+				--active;
+				if (eptr)
+					run.fail(std::move(eptr));
+				else if constexpr (false == std::is_void<Out>::value) {
+					if (false == run.failed())
+						parked.push_back(std::move(*output));
+				}
+
+				_drain();
+				_schedule();
+			}
+
+			void _drain() {
+				if constexpr (false == std::is_void<Out>::value) {
+					//pushing downstream may call back into the stage, the outer loop carries on
+					if (draining)
+						return;
+
+					draining = true;
+					while (false == parked.empty()) {
+						if (run.failed()) {
+							parked.clear();
+							break;
+						}
+						if (false == downstream->accepts())
+							break;
+
+						Out item = std::move(parked.front());
+						parked.pop_front();
+						downstream->push(std::move(item));
+					}
+					draining = false;
+				}
+			}
+
+			void _try_finish() {
+				if (false == closed || finished || false == queue.empty() || active > 0 || _parked() > 0)
+					return;
+
+				finished = true;
+				if constexpr (std::is_void<Out>::value)
+					run.complete();
+				else
+					downstream->close();
+			}
+
+			size_t _parked() const {
+				return parked.size();
+			}
+
+			using _output_type = std::conditional_t<std::is_void<Out>::value, char, Out>;
+
+			_pipeline_run& run;
+			function_type fn;
+			const unsigned int concurrency;
+			const size_t capacity;
+			_pipeline_input<Out>* downstream;
+
+			std::deque<In> queue;
+			std::deque<_output_type> parked;
+			unsigned int active;
+			bool closed;
+			bool finished;
+			bool draining;
+		};
+
+		//pulls the source under the run mutex while the first stage has room
+		template<typename T>
+		class _pipeline_source {
+		public:
+			_pipeline_source(_pipeline_run& run, std::function<std::optional<T>()> next, _pipeline_input<T>* downstream)
+				: run(run), next(std::move(next)), downstream(downstream), done(false), pumping(false) {
+			}
+
+			void pump() {
+				if (pumping)
+					return;
+
+				pumping = true;
+				while (false == done) {
+					if (run.failed()) {
+						_finish();
+						break;
+					}
+					if (false == downstream->accepts())
+						break;
+
+					std::optional<T> item;
+					try {
+						item = next();
+					}
+					catch (...) {
+						run.fail(std::current_exception());
+						continue;
+					}
+
+					if (!item) {
+						_finish();
+						break;
+					}
+					downstream->push(std::move(*item));
+				}
+				pumping = false;
+			}
+
+		private:
+			void _finish() {
+				done = true;
+				downstream->close();
+			}
+
+			_pipeline_run& run;
+			std::function<std::optional<T>()> next;
+			_pipeline_input<T>* downstream;
+			bool done;
+			bool pumping;
+		};
+
+		template<typename Fn>
+		struct _pipeline_stage_spec {
+			Fn fn;
+			unsigned int concurrency;
+			size_t capacity;
+		};
+
+		template<typename Fn>
+		struct _pipeline_sink_spec {
+			Fn fn;
+			unsigned int concurrency;
+			size_t capacity;
+		};
+	}
+
+	/*
+	Complete pipeline, from the source to the sink. Every run pulls the source again
+	and is settled when the sink consumed the last item, or with the first failure -
+	the items still queued are then dropped. Items may change their order in a stage
+	running more than one at a time.
+	*/
+	class pipeline
+	{
+	public:
+		using builder_type = std::function<void(detail::_pipeline_run&)>;
+
+		explicit pipeline(builder_type builder) : builder(std::move(builder)) {}
+
+		promise<void> run(executor& ex = executor::shared()) {
+			auto state = std::make_shared<detail::_pipeline_run>(ex);
+			promise<void> result(state->resolver.get_future());
+
+			builder(*state);
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->start();
+			return result;
+		}
+
+	private:
+		builder_type builder;
+	};
+
+	//source and the stages so far, yielding items of T
+	template<typename T>
+	class pipeline_part
+	{
+	public:
+		//builds the nodes feeding the given input
+		using builder_type = std::function<void(detail::_pipeline_run&, detail::_pipeline_input<T>&)>;
+
+		explicit pipeline_part(builder_type builder) : builder(std::move(builder)) {}
+
+		template<typename Fn, typename Out = std::invoke_result_t<Fn&, T>>
+		pipeline_part<Out> operator|(detail::_pipeline_stage_spec<Fn> spec) const {
+			static_assert(false == std::is_void<Out>::value, "a void stage ends the pipeline, use pro::sink");
+
+			auto upstream = builder;
+			return pipeline_part<Out>([upstream, spec](detail::_pipeline_run& run, detail::_pipeline_input<Out>& downstream) {
+				auto node = std::make_shared<detail::_pipeline_stage<T, Out>>(run, spec.fn, spec.concurrency, spec.capacity, &downstream);
+				downstream.on_space = [stage = node.get()] { stage->resume(); };
+				run.nodes.push_back(node);
+				upstream(run, *node);
+			});
+		}
+
+		template<typename Fn, typename = std::enable_if_t<std::is_invocable_v<Fn&, T>>>
+		pipeline operator|(detail::_pipeline_sink_spec<Fn> spec) const {
+			auto upstream = builder;
+			return pipeline([upstream, spec](detail::_pipeline_run& run) {
+				auto node = std::make_shared<detail::_pipeline_stage<T, void>>(run, spec.fn, spec.concurrency, spec.capacity, nullptr);
+				run.nodes.push_back(node);
+				upstream(run, *node);
+			});
+		}
+
+	private:
+		builder_type builder;
+	};
+
+	//source pulled from a generator returning std::optional<T>, an empty optional ends it
+	template<typename Generator, typename = std::enable_if_t<std::is_invocable_v<Generator&>>,
+		typename O = std::invoke_result_t<Generator&>, typename T = typename O::value_type>
+	pipeline_part<T> source(Generator generator) {
+		auto shared_generator = std::make_shared<Generator>(std::move(generator));
+		return pipeline_part<T>([shared_generator](detail::_pipeline_run& run, detail::_pipeline_input<T>& downstream) {
+			auto node = std::make_shared<detail::_pipeline_source<T>>(run, [shared_generator]() -> std::optional<T> {
+				return (*shared_generator)();
+			}, &downstream);
+			downstream.on_space = [source = node.get()] { source->pump(); };
+			run.start = downstream.on_space;
+			run.nodes.push_back(node);
+		});
+	}
+
+	//source iterating over a copy of the container, from the beginning on every run
+	template<typename Container, typename = std::enable_if_t<type_utils::is_container<Container>::value>,
+		typename T = typename Container::value_type>
+	pipeline_part<T> source(Container container) {
+		auto items = std::make_shared<const Container>(std::move(container));
+		return pipeline_part<T>([items](detail::_pipeline_run& run, detail::_pipeline_input<T>& downstream) {
+			auto node = std::make_shared<detail::_pipeline_source<T>>(run, [items, it = std::begin(*items)]() mutable -> std::optional<T> {
+				if (it == std::end(*items))
+					return std::nullopt;
+				return *it++;
+			}, &downstream);
+			downstream.on_space = [source = node.get()] { source->pump(); };
+			run.start = downstream.on_space;
+			run.nodes.push_back(node);
+		});
+	}
+
+	//'capacity' bounds the queue in front of the stage
+	template<typename Fn>
+	detail::_pipeline_stage_spec<std::decay_t<Fn>> stage(Fn&& fn, unsigned int concurrency = 1, size_t capacity = 16) {
+		return { std::forward<Fn>(fn), concurrency, capacity };
+	}
+
+	template<typename Fn>
+	detail::_pipeline_sink_spec<std::decay_t<Fn>> sink(Fn&& fn, unsigned int concurrency = 1, size_t capacity = 16) {
+		return { std::forward<Fn>(fn), concurrency, capacity };
+	}
+}
+
+#endif //PIPELINE_INCLUDED
\ No newline at end of file
@@ -17,6 +17,11 @@ namespace pro
 			detail::_promise_base<T>(std::forward<Function>(fun), std::forward<Args>(args)...) {
 		}
 
+		template<typename Alloc, typename Function, typename... Args>
+		promise(std::allocator_arg_t tag, const Alloc& alloc, Function&& fun, Args&&... args) :
+			detail::_promise_base<T>(tag, alloc, std::forward<Function>(fun), std::forward<Args>(args)...) {
+		}
+
 		promise(const resolver_fn_type& fun) :
 			detail::_promise_base<T>(std::forward<resolver_fn_type>(fun)) {
 		}
@@ -118,6 +123,8 @@ namespace pro
 
 		template<typename ExCb, typename Result = std::invoke_result_t<ExCb, std::exception_ptr>>
 		promise<Result> fail(ExCb&& exceptionCallback) {
+			static_assert(std::is_copy_constructible<T>::value,
+				"promise<T>.fail(ecb) copies a T rejection into an exception_ptr, use fail(rcb, ecb) for move-only T");
 			return promise<Result>(
 				[future = std::move(this->future), exceptionCallback]() mutable {
 				try {
@@ -143,6 +150,11 @@ namespace pro
 			_promise_base(std::forward<Function>(fun), std::forward<Args>(args)...) {
 		}
 
+		template<typename Alloc, typename Function, typename... Args>
+		promise(std::allocator_arg_t tag, const Alloc& alloc, Function&& fun, Args&&... args) :
+			_promise_base(tag, alloc, std::forward<Function>(fun), std::forward<Args>(args)...) {
+		}
+
 		template<typename Cb, typename RCb, typename ExCb, typename Result = std::invoke_result_t<Cb>,
 		typename = std::enable_if_t<std::is_same<Result, std::invoke_result_t<RCb>>::value>,
 		typename = std::enable_if_t<std::is_same<Result, std::invoke_result_t<ExCb, std::exception_ptr>>::value >>
@@ -236,6 +248,20 @@ namespace pro
 		return promise<T>(std::forward<Function>(fun), std::forward<Args>(args)...);
 	}
 
+	template<typename T, typename Alloc, typename Function, typename... Args,
+		typename = std::enable_if_t<std::is_invocable_r_v<T, Function, Args...>>>
+	promise<T> make_promise(std::allocator_arg_t tag, const Alloc& alloc, Function&& fun, Args&&... args) {
+		return promise<T>(tag, alloc, std::forward<Function>(fun), std::forward<Args>(args)...);
+	}
+
+	//the shared state lives in the memory resource, e.g. a per-request std::pmr::monotonic_buffer_resource
+	template<typename T, typename Function, typename... Args,
+		typename = std::enable_if_t<std::is_invocable_r_v<T, Function, Args...>>>
+	promise<T> make_promise(std::pmr::memory_resource* resource, Function&& fun, Args&&... args) {
+		return promise<T>(std::allocator_arg, std::pmr::polymorphic_allocator<std::byte>(resource),
+			std::forward<Function>(fun), std::forward<Args>(args)...);
+	}
+
 	template<typename T, typename = std::enable_if_t<!std::is_same<T, void>::value, bool>>
 	constexpr promise<T> make_rejected_promise(T rejection_value) {
 		return promise<T>(std::make_exception_ptr(std::move(rejection_value)));
@@ -0,0 +1,222 @@
+#pragma once
+#ifndef RECYCLING_RESOURCE_INCLUDED
+#define RECYCLING_RESOURCE_INCLUDED
+
+#include <memory_resource>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstddef>
+
+namespace pro
+{
+	/*
+	Memory resource keeping freed blocks in per-thread free lists, one per size class.
+	A block freed by another thread is pushed back to the list of the thread owning it
+	and picked up by that thread on its next miss. Meant for the small, short-lived
+	shared states of promises: the library allocates its own states and task nodes
+	from instance(), and it can be passed to make_promise or to an allocator.
+	*/
+	class recycling_resource : public std::pmr::memory_resource
+	{
+	public:
+		struct statistics {
+			unsigned long long allocations;
+			//allocations served from a free list
+			unsigned long long hits;
+			unsigned long long deallocations;
+			//deallocations made by another thread than the one owning the block
+			unsigned long long remote_frees;
+
+			double hit_rate() const {
+				return allocations ? static_cast<double>(hits) / allocations : 0.0;
+			}
+		};
+
+		//blocks of 32 to 1024 bytes are recycled, bigger ones go to the upstream resource
+		static constexpr size_t size_classes = 6;
+		static constexpr size_t min_block_size = 32;
+		//blocks kept by a thread in one size class, the rest is returned upstream
+		static constexpr size_t max_cached = 256;
+
+		static recycling_resource& instance()
+		{
+			//never destroyed, blocks may be freed by static and thread_local destructors
+			static recycling_resource* instance_ = new recycling_resource();
+			return *instance_;
+		}
+
+		statistics stats() const {
+			statistics result{ 0, 0, 0, 0 };
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			for (const _cache* cache : caches) {
+				result.allocations += cache->allocations.load(std::memory_order_relaxed);
+				result.hits += cache->hits.load(std::memory_order_relaxed);
+				result.deallocations += cache->deallocations.load(std::memory_order_relaxed);
+				result.remote_frees += cache->remote_frees.load(std::memory_order_relaxed);
+			}
+			return result;
+		}
+
+		recycling_resource(const recycling_resource&) = delete;
+		recycling_resource& operator=(const recycling_resource&) = delete;
+
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment) override {
+			size_t size_class = _size_class(bytes, alignment);
+			if (size_class == size_classes)
+				return upstream->allocate(bytes, alignment);
+
+			_cache& cache = _local();
+			_bump(cache.allocations);
+
+			_block* block = cache.free[size_class];
+			if (nullptr == block) {
+				//takes over everything other threads returned, counted once here instead of on every push
+				block = cache.remote[size_class].exchange(nullptr, std::memory_order_acquire);
+				for (_block* it = block; it != nullptr; it = it->next)
+					++cache.cached[size_class];
+			}
+
+			if (block) {
+				cache.free[size_class] = block->next;
+				--cache.cached[size_class];
+				_bump(cache.hits);
+			}
+			else {
+				block = static_cast<_block*>(upstream->allocate(_header + (min_block_size << size_class), alignof(std::max_align_t)));
+			}
+
+			block->owner = &cache;
+			return reinterpret_cast<std::byte*>(block) + _header;
+		}
+
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+			size_t size_class = _size_class(bytes, alignment);
+			if (size_class == size_classes) {
+				upstream->deallocate(p, bytes, alignment);
+				return;
+			}
+
+			_block* block = reinterpret_cast<_block*>(static_cast<std::byte*>(p) - _header);
+			_cache& cache = _local();
+			_bump(cache.deallocations);
+
+			if (block->owner == &cache) {
+				if (cache.cached[size_class] < max_cached) {
+					block->next = cache.free[size_class];
+					cache.free[size_class] = block;
+					++cache.cached[size_class];
+				}
+				else {
+					upstream->deallocate(block, _header + (min_block_size << size_class), alignof(std::max_align_t));
+				}
+				return;
+			}
+
+			_bump(cache.remote_frees);
+			std::atomic<_block*>& remote = block->owner->remote[size_class];
+			block->next = remote.load(std::memory_order_relaxed);
+			while (!remote.compare_exchange_weak(block->next, block,
+				std::memory_order_release,
+				std::memory_order_relaxed));
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+
+	private:
+		struct _cache;
+
+		//header in front of every recycled block, the link is only used while the block is free
+		struct _block {
+			_cache* owner;
+			_block* next;
+		};
+
+		static constexpr size_t _header = sizeof(_block) > alignof(std::max_align_t) ? sizeof(_block) : alignof(std::max_align_t);
+
+		//caches outlive their threads, a cache left by a finished thread is adopted by the next new one
+		struct _cache {
+			_cache() : free{}, cached{}, remote{}, allocations(0), hits(0), deallocations(0), remote_frees(0) {}
+
+			_block* free[size_classes];
+			size_t cached[size_classes];
+			std::atomic<_block*> remote[size_classes];
+
+			//written by the owning thread only
+			std::atomic<unsigned long long> allocations;
+			std::atomic<unsigned long long> hits;
+			std::atomic<unsigned long long> deallocations;
+			std::atomic<unsigned long long> remote_frees;
+		};
+
+		struct _cache_handle {
+			explicit _cache_handle(recycling_resource& owner) : owner(owner), cache(owner._adopt()) {}
+			~_cache_handle() {
+				owner._orphan(cache);
+			}
+
+			recycling_resource& owner;
+			_cache* cache;
+		};
+
+		recycling_resource() : upstream(std::pmr::new_delete_resource()) {}
+
+		_cache& _local() {
+			thread_local _cache_handle handle(*this);
+			return *handle.cache;
+		}
+
+		_cache* _adopt() {
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			if (false == orphans.empty()) {
+				_cache* cache = orphans.back();
+				orphans.pop_back();
+				return cache;
+			}
+
+			caches.push_back(new _cache());
+			return caches.back();
+		}
+
+		void _orphan(_cache* cache) {
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			orphans.push_back(cache);
+		}
+
+		static void _bump(std::atomic<unsigned long long>& counter) {
+			counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		static size_t _size_class(size_t bytes, size_t alignment) {
+			if (alignment > alignof(std::max_align_t))
+				return size_classes;
+
+			size_t size_class = 0;
+			for (size_t size = min_block_size; size_class < size_classes; ++size_class, size <<= 1) {
+				if (bytes <= size)
+					break;
+			}
+			return size_class;
+		}
+
+		std::pmr::memory_resource* upstream;
+
+		mutable std::mutex registry_mutex;
+		std::vector<_cache*> caches;
+		std::vector<_cache*> orphans;
+	};
+
+	namespace detail
+	{
+		//allocator of the library's internal shared states, subscriber lists and task nodes
+		template<typename T = std::byte>
+		std::pmr::polymorphic_allocator<T> _recycling() {
+			return std::pmr::polymorphic_allocator<T>(&recycling_resource::instance());
+		}
+	}
+}
+
+#endif //RECYCLING_RESOURCE_INCLUDED
\ No newline at end of file
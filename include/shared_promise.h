@@ -0,0 +1,147 @@
+#pragma once
+#ifndef SHARED_PROMISE_INCLUDED
+#define SHARED_PROMISE_INCLUDED
+
+#include <memory>
+#include <stdexcept>
+#include "./promise.h"
+#include "./utils/detached.h"
+#include "./utils/fanout.h"
+
+namespace pro
+{
+	/*
+	A promise with any number of consumers. Every .then() attached to any copy
+	is fired from the single settlement of the shared state and receives a const T&.
+	Continuations attached after the settlement run right away, on the calling thread.
+	*/
+	template<typename T, typename = std::enable_if_t<!std::is_void<T>::value> >
+	class shared_promise
+	{
+	public:
+		using value_type = T;
+
+		shared_promise(promise<T>&& source)
+			: state(std::make_shared<detail::_fanout<T>>()) {
+			auto owner = state;
+			detail::_settle_detached(std::move(source),
+				[owner](T value) { owner->resolve(std::move(value)); },
+				[owner](T value) { owner->reject(std::make_exception_ptr(std::move(value))); },
+				[owner](std::exception_ptr eptr) { owner->reject(std::move(eptr)); });
+		}
+
+		bool settled() const {
+			return state->settled();
+		}
+
+		size_t consumers() const {
+			return state->subscribers();
+		}
+
+		template<typename Cb, typename RCb, typename ExCb, typename Result = std::invoke_result_t<Cb, const T&>,
+		typename = std::enable_if_t<std::is_same<Result, std::invoke_result_t<RCb, const T&>>::value>,
+		typename = std::enable_if_t<std::is_same<Result, std::invoke_result_t<ExCb, std::exception_ptr>>::value >>
+		promise<Result> then(Cb&& callback, RCb&& rejectCallback, ExCb&& exceptionCallback) {
+			return _attach<Result>([callback, rejectCallback, exceptionCallback](const detail::_fanout<T>& s) mutable -> Result {
+				if (s.error())
+					return _dispatch(s.error(), rejectCallback, exceptionCallback);
+
+				try {
+					return callback(s.get());
+				}
+				catch (...) {
+					return exceptionCallback(std::current_exception());
+				}
+			});
+		}
+
+		template<typename Cb, typename RCb, typename Result = std::invoke_result_t<Cb, const T&>,
+		typename = std::enable_if_t<std::is_same<Result, std::invoke_result_t<RCb, const T&>>::value>>
+		promise<Result> then(Cb&& callback, RCb&& rejectCallback) {
+			return _attach<Result>([callback, rejectCallback](const detail::_fanout<T>& s) mutable -> Result {
+				//anything but a rejection with T passes through
+				if (s.error())
+					return _dispatch(s.error(), rejectCallback, [](std::exception_ptr eptr) -> Result { std::rethrow_exception(eptr); });
+				return callback(s.get());
+			});
+		}
+
+		template<typename Cb, typename Result = std::invoke_result_t<Cb, const T&>>
+		promise<Result> then(Cb&& callback) {
+			return _attach<Result>([callback](const detail::_fanout<T>& s) mutable -> Result {
+				if (s.error())
+					std::rethrow_exception(s.error());
+				return callback(s.get());
+			});
+		}
+
+		template<typename RCb, typename ExCb, typename Result = std::invoke_result_t<RCb, const T&>,
+		typename = std::enable_if_t<std::is_same<Result, std::invoke_result_t<ExCb, std::exception_ptr>>::value>>
+		promise<Result> fail(RCb&& rejectCallback, ExCb&& exceptionCallback) {
+			return _attach<Result>([rejectCallback, exceptionCallback](const detail::_fanout<T>& s) mutable -> Result {
+				if (s.error())
+					return _dispatch(s.error(), rejectCallback, exceptionCallback);
+				throw std::logic_error("shared_promise<T>.fail unhandled control path");
+			});
+		}
+
+		template<typename ExCb, typename Result = std::invoke_result_t<ExCb, std::exception_ptr>>
+		promise<Result> fail(ExCb&& exceptionCallback) {
+			return _attach<Result>([exceptionCallback](const detail::_fanout<T>& s) mutable -> Result {
+				if (s.error())
+					return exceptionCallback(s.error());
+				throw std::logic_error("shared_promise<T>.fail unhandled control path");
+			});
+		}
+
+	private:
+		//a rejection is a thrown T, it is caught by reference so it is not copied either
+		template<typename RCb, typename ExCb>
+		static auto _dispatch(std::exception_ptr eptr, RCb& rejectCallback, ExCb&& exceptionCallback) {
+			try {
+				std::rethrow_exception(eptr);
+			}
+			catch (const T& reason) {
+				return rejectCallback(reason);
+			}
+			catch (...) {
+				return exceptionCallback(std::current_exception());
+			}
+
+			throw std::logic_error("shared_promise<T> unhandled control path");
+		}
+
+		template<typename Result, typename Fn>
+		static void _fulfil(std::promise<Result>& resolver, Fn&& fn) {
+			try {
+				if constexpr (std::is_void<Result>::value) {
+					fn();
+					resolver.set_value();
+				}
+				else {
+					resolver.set_value(fn());
+				}
+			}
+			catch (...) {
+				resolver.set_exception(std::current_exception());
+			}
+		}
+
+		template<typename Result, typename Continuation>
+		promise<Result> _attach(Continuation&& continuation) {
+			auto resolver = std::make_shared<std::promise<Result>>(std::allocator_arg, detail::_recycling());
+			promise<Result> result(resolver->get_future());
+
+			//the listener is owned by the state, it never outlives it
+			auto owner = state.get();
+			state->observe([owner, resolver, continuation]() mutable {
+				_fulfil(*resolver, [&] { return continuation(*owner); });
+			});
+			return result;
+		}
+
+		std::shared_ptr<detail::_fanout<T>> state;
+	};
+}
+
+#endif //SHARED_PROMISE_INCLUDED
\ No newline at end of file
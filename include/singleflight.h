@@ -0,0 +1,101 @@
+#pragma once
+#ifndef SINGLEFLIGHT_INCLUDED
+#define SINGLEFLIGHT_INCLUDED
+
+#include <unordered_map>
+#include <atomic>
+#include "./promise.h"
+#include "./utils/fanout.h"
+#include "./utils/detached.h"
+
+namespace pro
+{
+	/*
+	Coalesces concurrent requests for the same key: the first caller starts the work,
+	everyone asking before it settles gets a promise of that same outcome.
+	The key is forgotten as soon as its promise settles.
+	*/
+	template<typename K, typename T, typename Hash = std::hash<K>, typename = std::enable_if_t<!std::is_void<T>::value>>
+	class singleflight
+	{
+	public:
+		singleflight() : flights(std::make_shared<_flights>()) {}
+
+		template<typename Factory, typename = std::enable_if_t<std::is_invocable_r_v<promise<T>, Factory>>>
+		promise<T> get(const K& key, Factory&& factory) {
+			std::shared_ptr<detail::_fanout<T>> flight;
+			{
+				std::lock_guard<std::mutex> lock(flights->mutex);
+				auto it = flights->in_flight.find(key);
+				if (it != flights->in_flight.end()) {
+					++flights->coalesced;
+					return it->second->subscribe();
+				}
+
+				flight = std::make_shared<detail::_fanout<T>>();
+				flights->in_flight.emplace(key, flight);
+			}
+
+			//nothing settles the flight before its leader is started below
+			promise<T> subscription = flight->subscribe();
+			promise<T> leader = _start(std::forward<Factory>(factory));
+			auto owner = flights;
+
+			detail::_settle_detached(std::move(leader),
+				[owner, key, flight](T value) {
+					owner->forget(key, flight);
+					flight->resolve(value);
+				},
+				[owner, key, flight](T value) {
+					owner->forget(key, flight);
+					flight->reject(std::make_exception_ptr(std::move(value)));
+				},
+				[owner, key, flight](std::exception_ptr eptr) {
+					owner->forget(key, flight);
+					flight->reject(std::move(eptr));
+				});
+
+			return subscription;
+		}
+
+		size_t in_flight() const {
+			std::lock_guard<std::mutex> lock(flights->mutex);
+			return flights->in_flight.size();
+		}
+
+		//number of callers which joined an in-flight request instead of starting one
+		unsigned long long coalesced() const {
+			return flights->coalesced.load();
+		}
+
+	private:
+		struct _flights {
+			_flights() : coalesced(0) {}
+
+			void forget(const K& key, const std::shared_ptr<detail::_fanout<T>>& flight) {
+				std::lock_guard<std::mutex> lock(mutex);
+				auto it = in_flight.find(key);
+				if (it != in_flight.end() && it->second == flight)
+					in_flight.erase(it);
+			}
+
+			std::mutex mutex;
+			std::unordered_map<K, std::shared_ptr<detail::_fanout<T>>, Hash> in_flight;
+			std::atomic<unsigned long long> coalesced;
+		};
+
+		template<typename Factory>
+		static promise<T> _start(Factory&& factory) {
+			try {
+				return factory();
+			}
+			catch (...) {
+				return promise<T>(std::current_exception());
+			}
+		}
+
+		std::shared_ptr<_flights> flights;
+	};
+}
+
+#endif //SINGLEFLIGHT_INCLUDED
\ No newline at end of file
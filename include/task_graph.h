@@ -0,0 +1,303 @@
+#pragma once
+#ifndef TASK_GRAPH_INCLUDED
+#define TASK_GRAPH_INCLUDED
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <optional>
+#include "./promise.h"
+#include "./executor.h"
+
+namespace pro
+{
+	/*
+	Graph of tasks with dependencies. A run releases every node on the executor
+	as soon as all of its dependencies completed, nodes on the longest remaining
+	path (by cost) first. The graph is kept between runs and can be run again.
+	*/
+	class task_graph
+	{
+	public:
+		using node_id = size_t;
+		using task_type = std::function<void()>;
+
+		node_id add(task_type task, std::vector<node_id> dependencies = {}, unsigned int cost = 1) {
+			node_id id = nodes.size();
+			for (node_id dependency : dependencies) {
+				if (dependency >= id)
+					throw std::invalid_argument("task_graph node depends on an unknown node");
+			}
+
+			nodes.push_back(_node{ std::move(task), std::move(dependencies), {}, cost, 0 });
+			plan.reset();
+			return id;
+		}
+
+		size_t size() const {
+			return nodes.size();
+		}
+
+		//fulfills when the sink nodes completed, rejects with the first failure - nodes not started yet are skipped
+		promise<void> run(executor& ex = executor::shared()) {
+			if (nodes.empty()) {
+				std::promise<void> resolver;
+				resolver.set_value();
+				return promise<void>(resolver.get_future());
+			}
+
+			if (!plan)
+				plan = _prepare(nodes);
+
+			auto state = std::make_shared<_run>(plan, ex);
+			promise<void> result(state->resolver.get_future());
+
+			for (node_id root : plan->roots)
+				_run::release(state, root);
+			return result;
+		}
+
+		class instance;
+
+		//records the graph into an instance reusing its run state, later nodes added to the graph are not part of it
+		instance instantiate(executor& ex = executor::shared());
+
+		//length of the longest path starting at the node, weighted by cost
+		unsigned int critical_path(node_id id) {
+			if (!plan)
+				plan = _prepare(nodes);
+			return plan->nodes[id].priority;
+		}
+
+	private:
+		struct _node {
+			task_type task;
+			std::vector<node_id> dependencies;
+			std::vector<node_id> dependents;
+			unsigned int cost;
+			unsigned int priority;
+		};
+
+		struct _plan {
+			std::vector<_node> nodes;
+			std::vector<node_id> roots;
+		};
+
+		struct _run {
+			_run(std::shared_ptr<const _plan> plan, executor& ex)
+				: plan(plan),
+				ex(ex),
+				waiting_for(plan->nodes.size()),
+				remaining(plan->nodes.size()),
+				failed(false) {
+				for (size_t i = 0; i < plan->nodes.size(); ++i)
+					waiting_for[i].store(static_cast<unsigned int>(plan->nodes[i].dependencies.size()));
+			}
+
+			static void release(const std::shared_ptr<_run>& self, node_id id) {
+				const _node& node = self->plan->nodes[id];
+				self->ex.submit([self, id] { _run::execute(self, id); }, static_cast<int>(node.priority));
+			}
+
+			static void execute(const std::shared_ptr<_run>& self, node_id id) {
+				const _node& node = self->plan->nodes[id];
+
+				if (false == self->failed.load()) {
+					try {
+						node.task();
+					}
+					catch (...) {
+						std::lock_guard<std::mutex> lock(self->mutex);
+						if (false == self->failed.exchange(true))
+							self->eptr = std::current_exception();
+					}
+				}
+
+				for (node_id dependent : node.dependents) {
+					if (self->waiting_for[dependent].fetch_sub(1) == 1)
+						release(self, dependent);
+				}
+
+				if (self->remaining.fetch_sub(1) == 1) {
+					if (self->failed.load())
+						self->resolver.set_exception(self->eptr);
+					else
+						self->resolver.set_value();
+				}
+			}
+
+			std::shared_ptr<const _plan> plan;
+			executor& ex;
+			std::vector<std::atomic<unsigned int>> waiting_for;
+			std::atomic<size_t> remaining;
+
+			std::mutex mutex;
+			std::atomic<bool> failed;
+			std::exception_ptr eptr;
+			std::promise<void> resolver;
+		};
+
+		static std::shared_ptr<const _plan> _prepare(const std::vector<_node>& graph) {
+			auto prepared = std::make_shared<_plan>();
+			prepared->nodes = graph;
+
+			for (node_id id = 0; id < prepared->nodes.size(); ++id) {
+				for (node_id dependency : prepared->nodes[id].dependencies)
+					prepared->nodes[dependency].dependents.push_back(id);
+				if (prepared->nodes[id].dependencies.empty())
+					prepared->roots.push_back(id);
+			}
+
+			//nodes only depend on nodes added before them, so the reverse insertion order is a reverse topological order
+			for (node_id id = prepared->nodes.size(); id-- > 0;) {
+				_node& node = prepared->nodes[id];
+				unsigned int longest = 0;
+				for (node_id dependent : node.dependents)
+					longest = std::max(longest, prepared->nodes[dependent].priority);
+				node.priority = node.cost + longest;
+			}
+			return prepared;
+		}
+
+		std::vector<_node> nodes;
+		std::shared_ptr<const _plan> plan;
+	};
+
+	/*
+	Recorded task graph. The counters, the failure slot and the scheduled tasks
+	are allocated once and reused, so launch() does not allocate. Only one run
+	can be in flight - the instance waits for it on destruction.
+	*/
+	class task_graph::instance
+	{
+	public:
+		instance(std::shared_ptr<const _plan> plan, executor& ex)
+			: plan(std::move(plan)),
+			ex(ex),
+			waiting_for(new std::atomic<unsigned int>[this->plan->nodes.size()]),
+			remaining(0),
+			failed(false),
+			running(false) {
+		}
+
+		instance(const instance&) = delete;
+		instance& operator=(const instance&) = delete;
+
+		~instance() {
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this] { return false == running; });
+		}
+
+		void launch() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (running)
+					throw std::logic_error("task_graph::instance is already running");
+				running = true;
+				eptr = nullptr;
+			}
+
+			if (plan->nodes.empty()) {
+				_complete();
+				return;
+			}
+
+			for (size_t i = 0; i < plan->nodes.size(); ++i)
+				waiting_for[i].store(static_cast<unsigned int>(plan->nodes[i].dependencies.size()));
+			remaining.store(plan->nodes.size());
+			failed.store(false);
+
+			for (node_id root : plan->roots)
+				_release(root);
+		}
+
+		//blocks until the current run completed, rethrows its first failure
+		void wait() {
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this] { return false == running; });
+			if (eptr)
+				std::rethrow_exception(eptr);
+		}
+
+		//launches a run, the returned promise is the only allocation made for it
+		promise<void> run() {
+			std::promise<void> result_resolver;
+			promise<void> result(result_resolver.get_future());
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (running)
+					throw std::logic_error("task_graph::instance is already running");
+				resolver = std::move(result_resolver);
+			}
+			launch();
+			return result;
+		}
+
+		size_t size() const {
+			return plan->nodes.size();
+		}
+
+	private:
+		void _release(node_id id) {
+			//a pointer and an index are stored inline by std::function, no allocation per node
+			ex.submit([self = this, id] { self->_execute(id); }, static_cast<int>(plan->nodes[id].priority));
+		}
+
+		void _execute(node_id id) {
+			const _node& node = plan->nodes[id];
+
+			if (false == failed.load()) {
+				try {
+					node.task();
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (false == failed.exchange(true))
+						eptr = std::current_exception();
+				}
+			}
+
+			for (node_id dependent : node.dependents) {
+				if (waiting_for[dependent].fetch_sub(1) == 1)
+					_release(dependent);
+			}
+
+			if (remaining.fetch_sub(1) == 1)
+				_complete();
+		}
+
+		void _complete() {
+			//notified under the lock, a waiter may destroy the instance right after
+			std::lock_guard<std::mutex> lock(mutex);
+			if (resolver) {
+				if (eptr)
+					resolver->set_exception(eptr);
+				else
+					resolver->set_value();
+				resolver.reset();
+			}
+			running = false;
+			cv.notify_all();
+		}
+
+		std::shared_ptr<const _plan> plan;
+		executor& ex;
+		std::unique_ptr<std::atomic<unsigned int>[]> waiting_for;
+		std::atomic<size_t> remaining;
+		std::atomic<bool> failed;
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool running;
+		std::exception_ptr eptr;
+		std::optional<std::promise<void>> resolver;
+	};
+
+	inline task_graph::instance task_graph::instantiate(executor& ex) {
+		if (!plan)
+			plan = _prepare(nodes);
+		return instance(plan, ex);
+	}
+}
+
+#endif //TASK_GRAPH_INCLUDED
\ No newline at end of file
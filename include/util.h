@@ -9,6 +9,13 @@
 #include "./utils/concurrency_pack.h"
 #include "./utils/concurrency_race.h"
 #include "./utils/concurrency_any.h"
+#include "./utils/concurrency_as_completed.h"
+#include "./utils/concurrency_all_stream.h"
+#include "./utils/concurrency_reduce.h"
+#include "./utils/concurrency_some.h"
+#include "./utils/concurrency_hedge.h"
+#include "./utils/concurrency_retry.h"
+#include "./async_generator.h"
 
 namespace pro {
 
@@ -65,6 +72,128 @@ namespace pro {
 			concurrency::concurrency_call_wrapper<concurrency::_promise_any<CT::PromiseType>, Container>::call_reduce,
 			std::move(container));
 	}
+
+	template<class Container, typename = std::enable_if_t<type_utils::is_container<Container>::value>,
+		typename CT = promise_type_utils::collection_type_traits<Container>>
+	concurrency::as_completed_range<typename CT::PromiseType>
+	as_completed(Container& container)
+	{
+		return concurrency::as_completed_range<typename CT::PromiseType>(container);
+	}
+
+	template<class Container, typename Cb, typename = std::enable_if_t<type_utils::is_container<Container>::value>,
+		typename CT = promise_type_utils::collection_type_traits<Container>,
+		typename = std::enable_if_t<std::is_invocable_v<Cb, unsigned int, pro::detail::_promise_state<typename CT::ValueType>>>>
+	promise<void>
+	as_completed(Container& container, Cb&& callback)
+	{
+		return make_promise<void>(
+			[callback](Container collection) mutable {
+				concurrency::_promise_as_completed<typename CT::PromiseType> states(collection);
+				typename concurrency::_promise_as_completed<typename CT::PromiseType>::Completion completion;
+
+				while (states.next(completion)) {
+					callback(completion.first, std::move(completion.second));
+				}
+			},
+			std::move(container));
+	}
+
+	//pulled from the generator: nothing is handed out until the consumer asks for it
+	template<class Container, typename = std::enable_if_t<type_utils::is_container<Container>::value>,
+		typename CT = promise_type_utils::collection_type_traits<Container>,
+		typename Completion = typename concurrency::_promise_as_completed<typename CT::PromiseType>::Completion>
+	async_generator<Completion>
+	as_completed_generator(Container& container)
+	{
+		auto states = std::make_shared<concurrency::_promise_as_completed<typename CT::PromiseType>>(container);
+		return async_generator<Completion>([states](typename async_generator<Completion>::yielder& yield) {
+			Completion completion;
+			while (states->next(completion))
+				yield(std::move(completion));
+		});
+	}
+
+	template<class Container, typename Cb, typename = std::enable_if_t<type_utils::is_container<Container>::value>,
+		typename PT = std::invoke_result_t<typename Container::value_type&>,
+		typename = std::enable_if_t<std::is_invocable_v<Cb, unsigned int, typename PT::value_type>>>
+	promise<void>
+	PromiseAllStream(Container& factories, unsigned int window, Cb&& callback)
+	{
+		return make_promise<void>(
+			[callback, window](Container collection) mutable {
+				concurrency::_promise_all_stream<PT, Container> states(collection, window);
+				states.run(callback);
+			},
+			std::move(factories));
+	}
+
+	template<class Container, typename Op, typename = std::enable_if_t<type_utils::is_container<Container>::value>,
+		typename CT = promise_type_utils::collection_type_traits<Container>>
+	promise<typename CT::ValueType>
+	PromiseReduce(Container& container, typename CT::ValueType init, Op op, executor& ex = executor::shared())
+	{
+		return make_promise<typename CT::ValueType>(
+			[init = std::move(init), op, &ex](Container collection) mutable {
+				concurrency::_promise_reduce<typename CT::PromiseType, Op> states(collection, std::move(init), std::move(op), ex);
+				return states.yield();
+			},
+			std::move(container));
+	}
+
+	template<class Container, typename = std::enable_if_t<type_utils::is_container<Container>::value>,
+		typename CT = promise_type_utils::collection_type_traits<Container>,
+		typename QT = typename concurrency::_promise_some<typename CT::PromiseType>::QuorumType>
+	promise<QT>
+	PromiseSome(Container& container, unsigned int k)
+	{
+		auto collection = std::make_shared<Container>(std::move(container));
+
+		//settled through a resolver, so the quorum is delivered without waiting for the stragglers
+		typename promise<QT>::resolver_fn_type fun = [collection, k](std::promise<QT> resolver) {
+			if (k > std::size(*collection)) {
+				resolver.set_exception(std::make_exception_ptr(std::range_error("Quorum larger than the collection")));
+				return;
+			}
+			if (k == 0) {
+				resolver.set_value(QT());
+				return;
+			}
+
+			concurrency::_promise_some<typename CT::PromiseType> states(*collection, k);
+			try {
+				resolver.set_value(states.quorum());
+			}
+			catch (...) {
+				resolver.set_exception(std::current_exception());
+			}
+		};
+		return promise<QT>(fun);
+	}
+
+	template<typename Factory, typename P = std::invoke_result_t<Factory&>>
+	promise<typename P::value_type>
+	hedge(Factory factory, std::chrono::steady_clock::duration delay, unsigned int max_attempts = 2)
+	{
+		auto states = std::make_shared<concurrency::_promise_hedge<P>>(std::move(factory), max_attempts, delay, std::nullopt);
+		return states->run();
+	}
+
+	template<typename Factory, typename P = std::invoke_result_t<Factory&>>
+	promise<typename P::value_type>
+	hedge(Factory factory, latency_percentile tracker, unsigned int max_attempts = 2)
+	{
+		auto states = std::make_shared<concurrency::_promise_hedge<P>>(std::move(factory), max_attempts, tracker.delay(), tracker);
+		return states->run();
+	}
+
+	template<typename Factory, typename P = std::invoke_result_t<Factory&>>
+	promise<typename P::value_type>
+	retry(Factory factory, retry_policy<typename P::value_type> policy = {})
+	{
+		auto states = std::make_shared<concurrency::_promise_retry<P>>(std::move(factory), std::move(policy));
+		return states->run();
+	}
 }
 
 #endif //UTILS_INCLUDED
\ No newline at end of file
@@ -0,0 +1,147 @@
+#pragma once
+
+#ifndef CONCURRENCY_ALL_STREAM_INCLUDED
+#define CONCURRENCY_ALL_STREAM_INCLUDED
+
+#include <optional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include "./../promise.h"
+
+namespace pro
+{
+	namespace concurrency
+	{
+		/*
+		Streaming PromiseAll over a collection of promise factories.
+		At most `window` promises are started ahead of the oldest undelivered one,
+		so results are handed out in input order using O(window) slots.
+		*/
+		template <typename P, typename FactoryContainer>
+		struct _promise_all_stream
+		{
+			using Result = typename P::value_type;
+
+			_promise_all_stream(FactoryContainer& fc, unsigned int windowSize)
+				: cursor(std::begin(fc)),
+				total(static_cast<unsigned int>(std::size(fc))),
+				window(windowSize > 0 ? windowSize : 1),
+				slots(windowSize > 0 ? windowSize : 1),
+				next_start(0),
+				next_emit(0),
+				rejected(false),
+				rejection_value(),
+				rejection_eptr(nullptr)
+			{}
+
+			template <typename Cb>
+			void run(Cb& callback)
+			{
+				std::unique_lock<std::mutex> lock(settle_mutex);
+				start_window(lock);
+
+				while (next_emit < total && false == rejected)
+				{
+					settle_cv.wait(lock, [this] {
+						return rejected || slots[next_emit % window].has_value();
+					});
+					if (rejected)
+						break;
+
+					Result value = std::move(*slots[next_emit % window]);
+					slots[next_emit % window].reset();
+					unsigned int idx = next_emit++;
+
+					lock.unlock();
+					settlers.pop_front();
+					callback(idx, std::move(value));
+					lock.lock();
+
+					start_window(lock);
+				}
+
+				lock.unlock();
+				settlers.clear();
+
+				if (rejected) {
+					if (rejection_eptr == nullptr)
+						throw rejection_value;
+					std::rethrow_exception(rejection_eptr);
+				}
+			}
+
+		private:
+			//called and returning with the lock held, the factories run without it
+			void start_window(std::unique_lock<std::mutex>& lock) {
+				//backpressure - nothing new is started while the reorder window is full
+				while (next_start < total && false == rejected && next_start - next_emit < window) {
+					unsigned int idx = next_start++;
+					auto factory = cursor;
+					++cursor;
+
+					lock.unlock();
+					P _promise = (*factory)();
+					promise<void> settler = settle(_promise, idx);
+					lock.lock();
+
+					settlers.push_back(std::move(settler));
+				}
+			}
+
+			void _resolve(Result value, unsigned int idx) {
+				std::lock_guard<std::mutex> lock(settle_mutex);
+				slots[idx % window] = std::move(value);
+				settle_cv.notify_all();
+			}
+
+			void _reject(Result value, unsigned int idx) {
+				std::lock_guard<std::mutex> lock(settle_mutex);
+				if (false == rejected) {
+					rejected = true;
+					rejection_value = std::move(value);
+				}
+				settle_cv.notify_all();
+			}
+
+			void _reject_ex(std::exception_ptr eptr, unsigned int idx) {
+				std::lock_guard<std::mutex> lock(settle_mutex);
+				if (false == rejected) {
+					rejected = true;
+					rejection_eptr = std::move(eptr);
+				}
+				settle_cv.notify_all();
+			}
+
+			promise<void> settle(P& _promise, unsigned int idx) {
+				auto resolveBound = std::bind(&_promise_all_stream<P, FactoryContainer>::_resolve, this, std::placeholders::_1, idx);
+				auto rejectBound = std::bind(&_promise_all_stream<P, FactoryContainer>::_reject, this, std::placeholders::_1, idx);
+				auto rejectExBound = std::bind(&_promise_all_stream<P, FactoryContainer>::_reject_ex, this, std::placeholders::_1, idx);
+
+				return _promise.then(resolveBound, rejectBound, rejectExBound);
+			}
+
+			decltype(std::begin(std::declval<FactoryContainer&>())) cursor;
+			const unsigned int total;
+			const unsigned int window;
+
+			std::vector<std::optional<Result>> slots;
+			unsigned int next_start;
+			unsigned int next_emit;
+
+			bool rejected;
+			Result rejection_value;
+			std::exception_ptr rejection_eptr;
+
+			std::mutex settle_mutex;
+			std::condition_variable settle_cv;
+
+			//continuations of the started, not yet delivered promises - declared last, joined first
+			std::deque<promise<void>> settlers;
+		};
+
+		//PromiseAllStream on promise<void> is not supported
+	}
+}
+
+#endif //CONCURRENCY_ALL_STREAM_INCLUDED
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+
+#ifndef CONCURRENCY_AS_COMPLETED_INCLUDED
+#define CONCURRENCY_AS_COMPLETED_INCLUDED
+
+#include <utility>
+#include "./concurrency_base.h"
+#include "./../state.h"
+
+namespace pro
+{
+	namespace concurrency
+	{
+		template <typename P>
+		struct _promise_as_completed : detail::_promise_concurrency_base<P, false>
+		{
+			using Result = typename detail::_promise_concurrency_base<P, false>::Result;
+			using YieldType = Result;
+			using Outcome = pro::detail::_promise_state<Result>;
+			using Completion = std::pair<unsigned int, Outcome>;
+
+			template <typename PromiseContainer>
+			_promise_as_completed(PromiseContainer&& pc)
+				: detail::_promise_concurrency_base<P, false>(pc, std::size(pc), std::size(pc), true),
+				total(static_cast<unsigned int>(std::size(pc))),
+				consumed(0) {}
+
+			/*
+			Blocks until the next promise settles and moves its outcome out of the queues.
+			Returns false once every promise has been handed out.
+			*/
+			bool next(Completion& completion)
+			{
+				if (consumed == total)
+					return false;
+
+				std::unique_lock<std::mutex> lock(this->settle_mutex);
+				this->settle_cv.wait(lock, [this] { return false == this->settle_order.empty(); });
+
+				bool rejected = this->settle_order.front();
+				this->settle_order.pop();
+
+				Outcome outcome;
+				if (rejected) {
+					auto rejection = this->rejection_results.pop();
+					completion.first = std::get<0>(rejection);
+
+					if (std::get<2>(rejection) == nullptr) {
+						outcome.set_rejected(std::move(std::get<1>(rejection)));
+					}
+					else {
+						outcome.set_rejected(std::move(std::get<2>(rejection)));
+					}
+				}
+				else {
+					auto result = this->results.pop();
+					completion.first = std::get<0>(result);
+					outcome.set_resolved(std::move(std::get<1>(result)));
+				}
+				completion.second = std::move(outcome);
+
+				++consumed;
+				return true;
+			}
+
+			YieldType yield() override
+			{
+				throw std::logic_error("_promise_as_completed<T> yields through next()");
+			}
+
+		private:
+			const unsigned int total;
+			unsigned int consumed;
+		};
+
+		template <typename P>
+		class as_completed_range
+		{
+		public:
+			using Completion = typename _promise_as_completed<P>::Completion;
+
+			class iterator
+			{
+			public:
+				using iterator_category = std::input_iterator_tag;
+				using value_type = Completion;
+				using difference_type = std::ptrdiff_t;
+				using pointer = Completion*;
+				using reference = Completion&;
+
+				iterator() : states(nullptr) {}
+				explicit iterator(_promise_as_completed<P>* _states) : states(_states) {
+					++(*this);
+				}
+
+				reference operator*() { return current; }
+				pointer operator->() { return &current; }
+
+				iterator& operator++() {
+					if (states != nullptr && false == states->next(current))
+						states = nullptr;
+					return *this;
+				}
+
+				bool operator==(const iterator& other) const { return states == other.states; }
+				bool operator!=(const iterator& other) const { return states != other.states; }
+
+			private:
+				_promise_as_completed<P>* states;
+				Completion current;
+			};
+
+			template <typename PromiseContainer>
+			as_completed_range(PromiseContainer&& pc)
+				: states(std::make_unique<_promise_as_completed<P>>(pc)) {}
+
+			iterator begin() { return iterator(states.get()); }
+			iterator end() { return iterator(); }
+
+		private:
+			std::unique_ptr<_promise_as_completed<P>> states;
+		};
+
+		//as_completed on promise<void> is not supported
+	}
+}
+
+#endif //CONCURRENCY_AS_COMPLETED_INCLUDED
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #include <tuple>
 #include <queue>
+#include <mutex>
+#include <condition_variable>
 #include "./../promise.h"
 #include "./concurrent_queue.h"
 
@@ -28,43 +30,72 @@ namespace pro
 				queue<std::tuple<int, Result>> results;
 				queue<std::tuple<int, Result, std::exception_ptr>> rejection_results;
 
+				//order of settlements (true - rejection), kept only when requested
+				const bool track_order;
+				std::queue<bool> settle_order;
+
+				//once cancelled, late settlements are dropped instead of queued
+				bool cancelled;
+
+				std::mutex settle_mutex;
+				std::condition_variable settle_cv;
+
 				template <typename PromiseContainer>
-				_promise_concurrency_base(PromiseContainer&& pc, unsigned int resLimit, unsigned int rejLimit)
+				_promise_concurrency_base(PromiseContainer&& pc, unsigned int resLimit, unsigned int rejLimit, bool trackOrder = false)
 					: res_limit(resLimit),
 					rej_limit(rejLimit),
-					yield_results(false)
+					yield_results(false),
+					track_order(trackOrder),
+					cancelled(false)
 				{
 					int n = 0;
 					auto _begin = std::begin(pc);
 					auto _end = std::end(pc);
 
-					std::queue<std::unique_ptr<promise<void>>> pp;
 					for (auto it = _begin; it < _end; ++it) {
-						pp.push(std::make_unique<promise<void>>(settle(*it, n++)));
+						settlers.push(std::make_unique<promise<void>>(settle(*it, n++)));
 					}
 				}
 
 				void _resolve(Result value, unsigned int idx) {
+					std::lock_guard<std::mutex> lock(settle_mutex);
+					if (cancelled)
+						return;
 					results.push(std::move(std::make_tuple(idx, std::move(value))));
 
 					if (results.size() >= res_limit)
 						yield_results = true;
+					_notify(false);
 				}
 
 				void _reject(Result value, unsigned int idx) {
+					std::lock_guard<std::mutex> lock(settle_mutex);
+					if (cancelled)
+						return;
 					rejection_results.push(std::move(std::make_tuple(idx, std::move(value), nullptr)));
 
 					if (rejection_results.size()
 						>= rej_limit)
 						yield_results = true;
+					_notify(true);
 				}
 
 				void _reject_ex(std::exception_ptr eptr, unsigned int idx) {
+					std::lock_guard<std::mutex> lock(settle_mutex);
+					if (cancelled)
+						return;
 					rejection_results.push(std::move(std::make_tuple(idx, Result(), std::move(eptr))));
 
 					if (rejection_results.size()
 						>= rej_limit)
 						yield_results = true;
+					_notify(true);
+				}
+
+				void _notify(bool rejected) {
+					if (track_order)
+						settle_order.push(rejected);
+					settle_cv.notify_all();
 				}
 
 				promise<void> settle(P& _promise, unsigned int idx) {
@@ -80,13 +111,30 @@ namespace pro
 				}
 
 				void wait() {
+					while (false == settlers.empty()) {
+						settlers.pop();
+					}
 					while (false == yield_results) {
 						//std::chrono::system_clock::time_point::min()
 						std::this_thread::sleep_for(std::chrono::milliseconds(10));
 					}
 				}
 
-				virtual YieldType yield() = 0;		
+				//waits for the limits only, without joining the remaining continuations
+				void wait_limits() {
+					std::unique_lock<std::mutex> lock(settle_mutex);
+					settle_cv.wait(lock, [this] { return yield_results; });
+				}
+
+				void cancel() {
+					std::lock_guard<std::mutex> lock(settle_mutex);
+					cancelled = true;
+				}
+
+				virtual YieldType yield() = 0;
+
+				//continuations feeding the queues; declared last, so they are joined before the queues go away
+				std::queue<std::unique_ptr<promise<void>>> settlers;
 			};
 
 			template <>
@@ -0,0 +1,188 @@
+#pragma once
+
+#ifndef CONCURRENCY_HEDGE_INCLUDED
+#define CONCURRENCY_HEDGE_INCLUDED
+
+#include <memory>
+#include <optional>
+#include <vector>
+#include <algorithm>
+#include "./../promise.h"
+#include "./timer.h"
+#include "./detached.h"
+
+namespace pro
+{
+	/*
+	Tracks a window of observed latencies and yields the given percentile of them.
+	Copies share the same samples.
+	*/
+	class latency_percentile
+	{
+	public:
+		using duration = std::chrono::steady_clock::duration;
+
+		latency_percentile(double percentile, duration initial, size_t window = 256)
+			: samples(std::make_shared<_samples>(percentile, initial, window)) {}
+
+		void record(duration latency) {
+			std::lock_guard<std::mutex> lock(samples->mutex);
+			if (samples->ring.size() < samples->window) {
+				samples->ring.push_back(latency);
+			}
+			else {
+				samples->ring[samples->next] = latency;
+			}
+			samples->next = (samples->next + 1) % samples->window;
+		}
+
+		duration delay() const {
+			std::vector<duration> sorted;
+			{
+				std::lock_guard<std::mutex> lock(samples->mutex);
+				if (samples->ring.empty())
+					return samples->initial;
+				sorted = samples->ring;
+			}
+
+			size_t nth = static_cast<size_t>(samples->percentile * (sorted.size() - 1));
+			std::nth_element(sorted.begin(), sorted.begin() + nth, sorted.end());
+			return sorted[nth];
+		}
+
+	private:
+		struct _samples {
+			_samples(double percentile, duration initial, size_t window)
+				: percentile(std::clamp(percentile, 0.0, 1.0)), initial(initial), window(std::max<size_t>(1, window)), next(0) {}
+
+			std::mutex mutex;
+			const double percentile;
+			const duration initial;
+			const size_t window;
+			size_t next;
+			std::vector<duration> ring;
+		};
+
+		std::shared_ptr<_samples> samples;
+	};
+
+	namespace concurrency
+	{
+		/*
+		Starts one attempt, then a backup each time `delay` passes without a result,
+		up to max_attempts. The first fulfillment wins, later outcomes are ignored.
+		A failed attempt with nothing else in flight starts the next one right away.
+		*/
+		template <typename P>
+		struct _promise_hedge : std::enable_shared_from_this<_promise_hedge<P>>
+		{
+			using Result = typename P::value_type;
+			using clock = pro::detail::timer_queue::clock;
+			using factory_type = std::function<P()>;
+
+			_promise_hedge(factory_type factory, unsigned int maxAttempts, clock::duration delay, std::optional<latency_percentile> tracker)
+				: factory(std::move(factory)),
+				max_attempts(std::max(1u, maxAttempts)),
+				delay(delay),
+				tracker(std::move(tracker)),
+				started(0),
+				failed(0),
+				settled(false),
+				timer(0) {}
+
+			promise<Result> run() {
+				promise<Result> result(resolver.get_future());
+
+				std::lock_guard<std::mutex> lock(mutex);
+				_start_attempt();
+				return result;
+			}
+
+		private:
+			void _start_attempt() {
+				++started;
+
+				P attempt = _make_attempt();
+				auto self = this->shared_from_this();
+				auto begin = clock::now();
+
+				pro::detail::_settle_detached(std::move(attempt),
+					[self, begin](Result value) { self->_resolve(std::move(value), clock::now() - begin); },
+					[self](Result value) { self->_reject(std::make_exception_ptr(std::move(value))); },
+					[self](std::exception_ptr eptr) { self->_reject(std::move(eptr)); });
+
+				if (started < max_attempts) {
+					std::weak_ptr<_promise_hedge<P>> weak = self;
+					timer = pro::detail::_timers().schedule(
+						tracker ? tracker->delay() : delay,
+						[weak] {
+							if (auto hedge = weak.lock())
+								hedge->_on_timer();
+						});
+				}
+			}
+
+			P _make_attempt() {
+				try {
+					return factory();
+				}
+				catch (...) {
+					return P(std::current_exception());
+				}
+			}
+
+			void _on_timer() {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (settled || started >= max_attempts)
+					return;
+
+				_start_attempt();
+			}
+
+			void _resolve(Result value, clock::duration latency) {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (settled)
+						return;
+					settled = true;
+					pro::detail::_timers().cancel(timer);
+				}
+
+				if (tracker)
+					tracker->record(latency);
+				resolver.set_value(std::move(value));
+			}
+
+			void _reject(std::exception_ptr eptr) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (settled)
+					return;
+
+				if (++failed == max_attempts) {
+					settled = true;
+					resolver.set_exception(std::move(eptr));
+				}
+				else if (failed == started) {
+					pro::detail::_timers().cancel(timer);
+					_start_attempt();
+				}
+			}
+
+			factory_type factory;
+			const unsigned int max_attempts;
+			const clock::duration delay;
+			std::optional<latency_percentile> tracker;
+
+			std::mutex mutex;
+			std::promise<Result> resolver;
+			unsigned int started;
+			unsigned int failed;
+			bool settled;
+			pro::detail::_timers_type::timer_id timer;
+		};
+
+		//hedge on promise<void> is not supported
+	}
+}
+
+#endif //CONCURRENCY_HEDGE_INCLUDED
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+
+#ifndef CONCURRENCY_REDUCE_INCLUDED
+#define CONCURRENCY_REDUCE_INCLUDED
+
+#include <optional>
+#include <vector>
+#include <memory>
+#include <numeric>
+#include <iterator>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "./../promise.h"
+#include "./../executor.h"
+
+namespace pro
+{
+	namespace concurrency
+	{
+		/*
+		Folds values into one accumulator per executor worker as the promises settle.
+		The settled values are taken in input order, each input is released right away
+		and its value is folded on a worker into that worker's accumulator, so the state
+		stays O(workers) no matter how many promises are reduced.
+		Op must be associative and commutative.
+		*/
+		template <typename P, typename Op>
+		struct _promise_reduce
+		{
+			using Result = typename P::value_type;
+
+			struct _stripe {
+				std::mutex mutex;
+				std::optional<Result> accumulator;
+			};
+
+			template <typename PromiseContainer>
+			_promise_reduce(PromiseContainer&& pc, Result init, Op op, executor& ex)
+				: init(std::move(init)),
+				op(std::move(op)),
+				ex(ex),
+				stripes(ex.threads()),
+				folding(0),
+				rejected(false),
+				rejection_value(),
+				rejection_eptr(nullptr)
+			{
+				for (auto it = std::begin(pc); it != std::end(pc) && false == rejected; ++it) {
+					//the input gives up its state, nothing of it is kept past its value
+					std::future<Result> input = *it;
+					try {
+						_fold(input.get());
+					}
+					catch (Result& rejection) {
+						_reject(std::move(rejection));
+					}
+					catch (...) {
+						_reject_ex(std::current_exception());
+					}
+				}
+			}
+
+			_promise_reduce(const _promise_reduce&) = delete;
+
+			//the folds still queued refer to this state
+			~_promise_reduce() {
+				std::unique_lock<std::mutex> lock(state_mutex);
+				folded_cv.wait(lock, [this] { return folding == 0; });
+			}
+
+			Result yield()
+			{
+				{
+					std::unique_lock<std::mutex> lock(state_mutex);
+					folded_cv.wait(lock, [this] { return folding == 0; });
+				}
+
+				if (rejected) {
+					if (rejection_eptr == nullptr)
+						throw rejection_value;
+					std::rethrow_exception(rejection_eptr);
+				}
+
+				std::vector<Result> partials;
+				partials.reserve(stripes.size());
+				for (auto& stripe : stripes) {
+					if (stripe.accumulator.has_value())
+						partials.push_back(std::move(*stripe.accumulator));
+				}
+				return std::accumulate(std::make_move_iterator(partials.begin()), std::make_move_iterator(partials.end()), init, op);
+			}
+
+		private:
+			void _fold(Result value) {
+				{
+					std::lock_guard<std::mutex> lock(state_mutex);
+					++folding;
+				}
+
+				//a task has to be copyable, the value is boxed instead
+				auto boxed = std::make_shared<Result>(std::move(value));
+				ex.submit([this, boxed] {
+					try {
+						_stripe& stripe = stripes[std::max(0, ex.worker_index())];
+						std::lock_guard<std::mutex> lock(stripe.mutex);
+
+						if (stripe.accumulator.has_value())
+							stripe.accumulator = op(std::move(*stripe.accumulator), std::move(*boxed));
+						else
+							stripe.accumulator = std::move(*boxed);
+					}
+					catch (...) {
+						_reject_ex(std::current_exception());
+					}
+
+					std::lock_guard<std::mutex> lock(state_mutex);
+					if (--folding == 0)
+						folded_cv.notify_all();
+				});
+			}
+
+			void _reject(Result value) {
+				std::lock_guard<std::mutex> lock(rejection_mutex);
+				if (false == rejected) {
+					rejection_value = std::move(value);
+					rejected = true;
+				}
+			}
+
+			void _reject_ex(std::exception_ptr eptr) {
+				std::lock_guard<std::mutex> lock(rejection_mutex);
+				if (false == rejected) {
+					rejection_eptr = std::move(eptr);
+					rejected = true;
+				}
+			}
+
+			Result init;
+			Op op;
+			executor& ex;
+			std::vector<_stripe> stripes;
+
+			std::mutex state_mutex;
+			std::condition_variable folded_cv;
+			size_t folding;
+
+			std::mutex rejection_mutex;
+			std::atomic<bool> rejected;
+			Result rejection_value;
+			std::exception_ptr rejection_eptr;
+		};
+
+		//PromiseReduce on promise<void> is not supported
+	}
+}
+
+#endif //CONCURRENCY_REDUCE_INCLUDED
\ No newline at end of file
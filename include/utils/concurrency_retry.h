@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef CONCURRENCY_RETRY_INCLUDED
+#define CONCURRENCY_RETRY_INCLUDED
+
+#include <memory>
+#include <random>
+#include <algorithm>
+#include "./../promise.h"
+#include "./timer.h"
+#include "./detached.h"
+
+namespace pro
+{
+	template <typename T>
+	struct retry_policy
+	{
+		using duration = std::chrono::steady_clock::duration;
+
+		unsigned int max_attempts = 3;
+		duration initial_delay = std::chrono::milliseconds(100);
+		double multiplier = 2.0;
+		duration max_delay = std::chrono::seconds(10);
+		//share of the delay which is randomized, 0 - none, 1 - full jitter
+		double jitter = 0.0;
+
+		//decide whether a rejection is worth another attempt; empty - always retry
+		std::function<bool(const T&)> retry_on_rejection;
+		std::function<bool(std::exception_ptr)> retry_on_exception;
+
+		duration delay_for(unsigned int attempt) const {
+			double delay = static_cast<double>(initial_delay.count());
+			for (unsigned int i = 1; i < attempt; ++i) {
+				delay *= multiplier;
+				if (delay >= static_cast<double>(max_delay.count()))
+					break;
+			}
+			delay = std::min(delay, static_cast<double>(max_delay.count()));
+
+			if (jitter > 0.0) {
+				thread_local std::mt19937 generator{ std::random_device{}() };
+				std::uniform_real_distribution<double> spread(0.0, std::min(jitter, 1.0));
+				delay -= delay * spread(generator);
+			}
+			return duration(static_cast<duration::rep>(delay));
+		}
+	};
+
+	namespace concurrency
+	{
+		/*
+		Restarts a failed attempt after a backoff. Waiting is a timer entry,
+		no thread is held between the attempts.
+		*/
+		template <typename P>
+		struct _promise_retry : std::enable_shared_from_this<_promise_retry<P>>
+		{
+			using Result = typename P::value_type;
+			using factory_type = std::function<P()>;
+
+			_promise_retry(factory_type factory, retry_policy<Result> policy)
+				: factory(std::move(factory)),
+				policy(std::move(policy)),
+				attempts(0) {}
+
+			promise<Result> run() {
+				promise<Result> result(resolver.get_future());
+				_start_attempt();
+				return result;
+			}
+
+		private:
+			void _start_attempt() {
+				++attempts;
+
+				P attempt = _make_attempt();
+				auto self = this->shared_from_this();
+
+				pro::detail::_settle_detached(std::move(attempt),
+					[self](Result value) { self->resolver.set_value(std::move(value)); },
+					[self](Result value) {
+						bool retry = !self->policy.retry_on_rejection || self->policy.retry_on_rejection(value);
+						self->_retry_or_reject(retry, std::make_exception_ptr(std::move(value)));
+					},
+					[self](std::exception_ptr eptr) {
+						bool retry = !self->policy.retry_on_exception || self->policy.retry_on_exception(eptr);
+						self->_retry_or_reject(retry, std::move(eptr));
+					});
+			}
+
+			P _make_attempt() {
+				try {
+					return factory();
+				}
+				catch (...) {
+					return P(std::current_exception());
+				}
+			}
+
+			void _retry_or_reject(bool retry, std::exception_ptr eptr) {
+				if (false == retry || attempts >= policy.max_attempts) {
+					resolver.set_exception(std::move(eptr));
+					return;
+				}
+
+				auto self = this->shared_from_this();
+				pro::detail::_timers().schedule(
+					policy.delay_for(attempts),
+					[self] { self->_start_attempt(); });
+			}
+
+			factory_type factory;
+			const retry_policy<Result> policy;
+			std::promise<Result> resolver;
+			unsigned int attempts;
+		};
+
+		//retry on promise<void> is not supported
+	}
+}
+
+#endif //CONCURRENCY_RETRY_INCLUDED
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#ifndef CONCURRENCY_SOME_INCLUDED
+#define CONCURRENCY_SOME_INCLUDED
+
+#include <utility>
+#include "./concurrency_base.h"
+
+namespace pro
+{
+	namespace concurrency
+	{
+		/*
+		k-of-n quorum: fulfills with the first k values, rejects as soon as
+		n - k + 1 promises failed, since the quorum can not be reached anymore.
+		*/
+		template <typename P>
+		struct _promise_some : detail::_promise_concurrency_base<P, false>
+		{
+			using Result = typename detail::_promise_concurrency_base<P, false>::Result;
+			using YieldType = Result;
+			using QuorumType = std::vector<std::pair<unsigned int, Result>>;
+
+			template <typename PromiseContainer>
+			_promise_some(PromiseContainer&& pc, unsigned int k)
+				: detail::_promise_concurrency_base<P, false>(pc, k, static_cast<unsigned int>(std::size(pc)) - k + 1) {}
+
+			QuorumType quorum()
+			{
+				this->wait_limits();
+				//the outcome is known, remaining promises are not buffered anymore
+				this->cancel();
+
+				if (this->results.size() < this->res_limit)
+				{
+					std::vector<std::exception_ptr> ex_vec;
+					while (false == this->rejection_results.empty()) {
+						auto rejection = this->rejection_results.pop();
+
+						if (std::get<2>(rejection) == nullptr) {
+							ex_vec.push_back(std::make_exception_ptr(std::get<1>(rejection)));
+						}
+						else {
+							ex_vec.push_back(std::get<2>(rejection));
+						}
+					}
+					throw AggregateException(ex_vec);
+				}
+
+				//results were pushed in the settlement order, the first k are the winners
+				std::vector<std::tuple<int, Result>> settled;
+				while (false == this->results.empty()) {
+					settled.push_back(this->results.pop());
+				}
+
+				QuorumType winners;
+				for (auto it = settled.begin(); it != settled.end() && winners.size() < this->res_limit; ++it) {
+					winners.emplace_back(std::get<0>(*it), std::move(std::get<1>(*it)));
+				}
+				return winners;
+			}
+
+			YieldType yield() override
+			{
+				throw std::logic_error("_promise_some<T> yields through quorum()");
+			}
+		};
+
+		//_promise_some on promise<void> is not supported
+	}
+}
+
+#endif //CONCURRENCY_SOME_INCLUDED
\ No newline at end of file
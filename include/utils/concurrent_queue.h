@@ -9,9 +9,10 @@
 namespace pro {
     namespace concurrency {
         /*
-        Note this is not a full lock-free queue, only push is thread-safe here
+        Note this is not a full lock-free queue, only push is thread-safe here.
+        Nodes and their data are allocated with the Allocator.
         */
-        template<typename T>
+        template<typename T, typename Allocator = std::allocator<T>>
         class queue
         {
         private:
@@ -21,14 +22,18 @@ namespace pro {
                 std::shared_ptr<T> data;
                 node* next;
 
-                node(const T& data) 
-                    : data(std::make_shared<T>(data)), next(nullptr)
+                node(const T& data, const Allocator& alloc) 
+                    : data(std::allocate_shared<T>(alloc, data)), next(nullptr)
                 {}
-                node(T&& data)
-                    : data(std::make_shared<T>(std::move(data))), next(nullptr)
+                node(T&& data, const Allocator& alloc)
+                    : data(std::allocate_shared<T>(alloc, std::move(data))), next(nullptr)
                 {}
             };
 
+            using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node<T>>;
+            using node_traits = std::allocator_traits<node_allocator>;
+            node_allocator alloc;
+
             std::atomic<node<T>*> head;
             std::atomic<node<T>*> tail;
             std::atomic<unsigned int> count;
@@ -37,9 +42,13 @@ namespace pro {
             queue() : tail(nullptr), head(nullptr), count(0)
             {}
 
+            explicit queue(const Allocator& alloc) : alloc(alloc), tail(nullptr), head(nullptr), count(0)
+            {}
+
             void push(T&& data)
             {
-                node<T>* new_node = new node<T>(std::move(data));
+                node<T>* new_node = node_traits::allocate(alloc, 1);
+                node_traits::construct(alloc, new_node, std::move(data), Allocator(alloc));
                 new_node->next = tail.load(std::memory_order_relaxed);
 
                 node<T>* old_tail = tail.load(std::memory_order_relaxed);
@@ -81,7 +90,8 @@ namespace pro {
                 else head.store(nullptr);
                     
                 std::shared_ptr<T> const res(old_head->data);
-                delete old_head;
+                node_traits::destroy(alloc, old_head);
+                node_traits::deallocate(alloc, old_head, 1);
 
                 count.fetch_sub(1);
                 return std::move(*(res.get()));
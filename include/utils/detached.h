@@ -0,0 +1,69 @@
+#pragma once
+
+#ifndef PROMISE_DETACHED_INCLUDED
+#define PROMISE_DETACHED_INCLUDED
+
+#include <thread>
+#include "./../promise.h"
+
+namespace pro
+{
+	namespace detail
+	{
+		/*
+		Like promise<T>.then(cb, rcb, ecb), but the outcome is awaited on a detached thread,
+		so nothing blocks when the caller drops its handles.
+		*/
+		template<typename T, typename Cb, typename RCb, typename ExCb>
+		void _settle_detached(promise<T>&& _promise, Cb&& callback, RCb&& rejectCallback, ExCb&& exceptionCallback) {
+			std::thread t(
+				[future = std::future<T>(_promise), callback, rejectCallback, exceptionCallback]() mutable {
+					std::exception_ptr eptr;
+					try {
+						T result = future.get();
+						try {
+							callback(std::move(result));
+						}
+						catch (...) {
+							eptr = std::current_exception();
+						}
+					}
+					catch (T& ex) {
+						rejectCallback(std::move(ex));
+					}
+					catch (...) {
+						eptr = std::current_exception();
+					}
+
+					if (eptr) {
+						exceptionCallback(std::move(eptr));
+					}
+				}
+			);
+			t.detach();
+		}
+
+		template<typename Cb, typename ExCb>
+		void _settle_detached(promise<void>&& _promise, Cb&& callback, ExCb&& exceptionCallback) {
+			std::thread t(
+				[future = std::future<void>(_promise), callback, exceptionCallback]() mutable {
+					std::exception_ptr eptr;
+					try {
+						future.get();
+						callback();
+					}
+					catch (...) {
+						eptr = std::current_exception();
+					}
+
+					if (eptr) {
+						exceptionCallback(std::move(eptr));
+					}
+				}
+			);
+			t.detach();
+		}
+	}
+}
+
+#endif //PROMISE_DETACHED_INCLUDED
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+
+#ifndef PROMISE_FANOUT_INCLUDED
+#define PROMISE_FANOUT_INCLUDED
+
+#include <vector>
+#include <optional>
+#include <mutex>
+#include <functional>
+#include "./../promise.h"
+#include "./../recycling_resource.h"
+
+namespace pro
+{
+	namespace detail
+	{
+		/*
+		Multi-consumer shared state: one outcome settles every subscribed promise.
+		Subscribers arriving after the settlement get an already settled promise.
+		Observers are called instead, and read the outcome in place.
+		*/
+		template<typename T>
+		class _fanout
+		{
+		public:
+			_fanout() : eptr(nullptr) {}
+
+			promise<T> subscribe() {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (value.has_value())
+					return promise<T>(*value);
+				if (eptr)
+					return promise<T>(eptr);
+
+				std::promise<T> waiter(std::allocator_arg, detail::_recycling());
+				promise<T> subscription(waiter.get_future());
+				waiters.push_back(std::move(waiter));
+				return subscription;
+			}
+
+			void resolve(const T& result) {
+				_settle([&] { value = result; });
+			}
+
+			void resolve(T&& result) {
+				_settle([&] { value = std::move(result); });
+			}
+
+			void reject(std::exception_ptr rejection) {
+				_settle([&] { eptr = rejection; });
+			}
+
+			//listener runs once the outcome is set, right away when it is set already
+			void observe(std::function<void()> listener) {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (false == _settled()) {
+						listeners.push_back(std::move(listener));
+						return;
+					}
+				}
+				listener();
+			}
+
+			bool settled() {
+				std::lock_guard<std::mutex> lock(mutex);
+				return _settled();
+			}
+
+			//the outcome is immutable once settled, listeners read it without the lock
+			const T& get() const {
+				return *value;
+			}
+
+			std::exception_ptr error() const {
+				return eptr;
+			}
+
+			size_t subscribers() {
+				std::lock_guard<std::mutex> lock(mutex);
+				return waiters.size() + listeners.size();
+			}
+
+		private:
+			bool _settled() const {
+				return value.has_value() || eptr;
+			}
+
+			template<typename Set>
+			void _settle(Set&& set) {
+				std::vector<std::promise<T>> subscribed;
+				std::vector<std::function<void()>> observers;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					set();
+					subscribed.swap(waiters);
+					observers.swap(listeners);
+				}
+
+				for (auto& waiter : subscribed) {
+					if (eptr)
+						waiter.set_exception(eptr);
+					else
+						waiter.set_value(*value);
+				}
+				for (auto& listener : observers)
+					listener();
+			}
+
+			std::mutex mutex;
+			std::vector<std::promise<T>> waiters;
+			std::vector<std::function<void()>> listeners;
+			std::optional<T> value;
+			std::exception_ptr eptr;
+		};
+	}
+}
+
+#endif //PROMISE_FANOUT_INCLUDED
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#ifndef PROMISE_TIMER_INCLUDED
+#define PROMISE_TIMER_INCLUDED
+
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#if defined(PRO_IO_TIMERS) && defined(__linux__)
+#include "./../io/timer.h"
+#endif
+
+namespace pro
+{
+	namespace detail
+	{
+		/*
+		One thread serving every delayed task of the library.
+		Tasks are run on the timer thread, so they should only kick off work.
+		*/
+		class timer_queue
+		{
+		public:
+			using clock = std::chrono::steady_clock;
+			using timer_id = unsigned long long;
+			using task_type = std::function<void()>;
+
+			static timer_queue& instance()
+			{
+				static timer_queue instance_;
+				return instance_;
+			}
+
+			timer_id schedule(clock::duration delay, task_type task) {
+				std::lock_guard<std::mutex> lock(mutex);
+				timer_id id = next_id++;
+				clock::time_point deadline = clock::now() + delay;
+
+				tasks.emplace(std::make_pair(deadline, id), std::move(task));
+				deadlines.emplace(id, deadline);
+				cv.notify_one();
+				return id;
+			}
+
+			bool cancel(timer_id id) {
+				std::lock_guard<std::mutex> lock(mutex);
+				auto it = deadlines.find(id);
+				if (it == deadlines.end())
+					return false;
+
+				tasks.erase(std::make_pair(it->second, id));
+				deadlines.erase(it);
+				return true;
+			}
+
+			size_t pending() {
+				std::lock_guard<std::mutex> lock(mutex);
+				return tasks.size();
+			}
+
+		private:
+			timer_queue() : next_id(1), stopping(false) {
+				worker = std::thread(&timer_queue::run, this);
+			}
+			timer_queue(const timer_queue&) = delete;
+			~timer_queue() {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stopping = true;
+				}
+				cv.notify_one();
+				worker.join();
+			}
+
+			void run() {
+				std::unique_lock<std::mutex> lock(mutex);
+				while (false == stopping) {
+					if (tasks.empty()) {
+						cv.wait(lock);
+						continue;
+					}
+
+					auto first = tasks.begin();
+					if (first->first.first > clock::now()) {
+						cv.wait_until(lock, first->first.first);
+						continue;
+					}
+
+					task_type task = std::move(first->second);
+					deadlines.erase(first->first.second);
+					tasks.erase(first);
+
+					lock.unlock();
+					task();
+					lock.lock();
+				}
+			}
+
+			std::mutex mutex;
+			std::condition_variable cv;
+			timer_id next_id;
+			bool stopping;
+
+			std::map<std::pair<clock::time_point, timer_id>, task_type> tasks;
+			std::unordered_map<timer_id, clock::time_point> deadlines;
+			std::thread worker;
+		};
+
+		/*
+		Where the library schedules its delays: the timer thread above. Defining
+		PRO_IO_TIMERS on Linux moves them to the reactor's timing wheel instead,
+		which pulls in io/timer.h and the epoll reactor with it.
+		*/
+#if defined(PRO_IO_TIMERS) && defined(__linux__)
+		using _timers_type = io::timer_queue;
+
+		inline _timers_type& _timers() {
+			return io::timer_queue::shared();
+		}
+#else
+		using _timers_type = timer_queue;
+
+		inline _timers_type& _timers() {
+			return timer_queue::instance();
+		}
+#endif
+	}
+}
+
+#endif //PROMISE_TIMER_INCLUDED
\ No newline at end of file
@@ -1,10 +1,38 @@
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 
 #include <string>
+#include <set>
 #include "./catch/catch_amalgamated.hpp"
 #include "../include/promise.h"
 #include "../include/ready_promise.h"
 #include "../include/util.h"
+#include "../include/singleflight.h"
+#include "../include/async_cache.h"
+#include "../include/batcher.h"
+#include "../include/shared_promise.h"
+#include "../include/task_graph.h"
+#include "../include/recycling_resource.h"
+#include "../include/pipeline.h"
+#include "../include/channel.h"
+#include "../include/async_mutex.h"
+#include "../include/async_latch.h"
+#include "../include/async_generator.h"
+#include "../include/io/reactor.h"
+#include "../include/io/file.h"
+#include "../include/io/timer.h"
+#include "../include/io/process.h"
+#include "../include/io/ipc.h"
+#include "../include/io/pollable.h"
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <fstream>
+#endif
 
 //Test wrappers for promise<T>.then(resolve, reject)
 int wrapThenTypedPromise(pro::promise<int> &p) {
@@ -122,6 +150,63 @@ CopyCounter returnCounter() {
     return CopyCounter();
 }
 
+//Memory resource counting the allocations passed to the upstream resource
+struct CountingResource : std::pmr::memory_resource {
+    std::atomic<int> allocated = 0;
+    std::atomic<int> deallocated = 0;
+    std::pmr::memory_resource* upstream = std::pmr::new_delete_resource();
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocated;
+        return upstream->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        ++deallocated;
+        upstream->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+
+#ifdef __linux__
+//Peer process of the ipc tests: this binary started again with PRO_IPC_PEER="role:name"
+struct IpcPoint {
+    int x;
+    int y;
+};
+
+pid_t spawnIpcPeer(const std::string& role, const std::string& name) {
+    std::string variable = "PRO_IPC_PEER=" + role + ":" + name;
+    char* argv[] = { const_cast<char*>("/proc/self/exe"), nullptr };
+    char* envp[] = { const_cast<char*>(variable.c_str()), nullptr };
+    pid_t pid = -1;
+    return ::posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, argv, envp) == 0 ? pid : -1;
+}
+
+//runs before main(), so the peer never starts the test runner
+const bool ipcPeer = [] {
+    const char* peer = ::getenv("PRO_IPC_PEER");
+    if (peer == nullptr)
+        return false;
+
+    std::string role(peer);
+    std::string name = role.substr(role.find(':') + 1);
+    role.resize(role.find(':'));
+
+    int code = 0;
+    if (role == "settle") {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        pro::ipc::shared_promise<IpcPoint>::open(name).set_value(IpcPoint{ 3, 4 });
+    }
+    else if (role == "await") {
+        pro::ipc::shared_promise<int>::open(name).get_promise().then([&code](int) { code = 1; }, [&code](int reason) { code = reason; });
+    }
+    //any other role just exits
+    ::_exit(code);
+}();
+#endif
 
 ///////////////////////
 //Tests for promise<T>
@@ -1229,4 +1314,2203 @@ TEST_CASE("Promise copy/move behaviour", "[basic]")
 
         REQUIRE(copied_res == 0);
     }
-}
\ No newline at end of file
+}
+TEST_CASE("as_completed", "[util]")
+{
+    SECTION("Outcomes are yielded in completion order, with their indices") {
+        std::vector<unsigned int> order;
+
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, 230, 115));
+        v.emplace_back(pro::make_promise<int>(returnInt, 666));
+        v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, 115, 420));
+
+        for (auto& completion : pro::as_completed(v)) {
+            REQUIRE(completion.second.is_resolved());
+            order.push_back(completion.first);
+        }
+
+        REQUIRE(order == std::vector<unsigned int>{ 1, 2, 0 });
+    }
+
+    SECTION("The first outcome does not wait for the slowest promise") {
+        auto start = std::chrono::system_clock::now();
+
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, 500, 115));
+        v.emplace_back(pro::make_promise<int>(returnInt, 666));
+
+        auto range = pro::as_completed(v);
+        auto it = range.begin();
+
+        auto end = std::chrono::system_clock::now();
+        REQUIRE(it->second.get_value() == 666);
+        REQUIRE(200 > std::chrono::duration_cast <std::chrono::milliseconds> (end - start).count());
+    }
+
+    SECTION("Rejections are yielded as rejected outcomes") {
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>(returnInt, 115));
+        v.emplace_back(pro::make_promise<int>([]()->int { throw 666; }));
+        v.emplace_back(pro::make_promise<int>([]()->int { throw std::exception("ex"); }));
+
+        for (auto& completion : pro::as_completed(v)) {
+            if (completion.second.is_resolved()) {
+                res += completion.second.get_value();
+            }
+            else if (completion.first == 1) {
+                REQUIRE(completion.second.is_rejected());
+                res += completion.second.get_value();
+            }
+            else {
+                REQUIRE_THROWS_AS(completion.second.get_value(), std::exception);
+            }
+        }
+
+        REQUIRE(res == 115 + 666);
+    }
+
+    SECTION("Callback version visits every promise") {
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, 115, 115));
+        v.emplace_back(pro::make_promise<int>(returnInt, 666));
+
+        pro::as_completed(v, [&res](unsigned int idx, auto outcome) {
+            res += outcome.get_value();
+        }).then([&res]() { res *= 2; });
+
+        REQUIRE(res == (115 + 666) * 2);
+    }
+
+    SECTION("Generator version yields outcomes on demand") {
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, 115, 115));
+        v.emplace_back(pro::make_promise<int>(returnInt, 666));
+
+        auto completions = pro::as_completed_generator(v);
+        unsigned int first = 2;
+        completions.next().then([&first](auto completion) { first = completion->first; });
+        REQUIRE(first == 1);
+
+        int res = 0;
+        completions.for_each([&res](auto completion) { res += completion.second.get_value(); }).then([] {});
+        REQUIRE(res == 115);
+    }
+
+    SECTION("Empty collection yields nothing") {
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        for (auto& completion : pro::as_completed(v)) {
+            res++;
+        }
+
+        REQUIRE(res == 0);
+    }
+}
+
+TEST_CASE("PromiseAllStream", "[util]")
+{
+    SECTION("Results are delivered in input order") {
+        std::vector<int> res;
+
+        std::vector<std::function<pro::promise<int>()>> v;
+        v.emplace_back([] { return pro::make_promise<int>(sleepAndReturnInt, 115, 1); });
+        v.emplace_back([] { return pro::make_promise<int>(returnInt, 2); });
+        v.emplace_back([] { return pro::make_promise<int>(sleepAndReturnInt, 50, 3); });
+        v.emplace_back([] { return pro::make_promise<int>(returnInt, 4); });
+
+        pro::PromiseAllStream(v, 2, [&res](unsigned int idx, int value) {
+            CHECK(idx + 1 == value);
+            res.push_back(value);
+        });
+
+        REQUIRE(res == std::vector<int>{ 1, 2, 3, 4 });
+    }
+
+    SECTION("A full window stops starting new promises") {
+        std::atomic<int> running = 0;
+        std::atomic<int> max_running = 0;
+
+        auto factory = [&running, &max_running] {
+            int now = ++running;
+            int seen = max_running.load();
+            while (now > seen && false == max_running.compare_exchange_weak(seen, now));
+
+            return pro::make_promise<int>([&running] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                --running;
+                return 1;
+            });
+        };
+        std::vector<std::function<pro::promise<int>()>> v(8, factory);
+
+        int res = 0;
+        pro::PromiseAllStream(v, 3, [&res](unsigned int, int value) { res += value; });
+
+        CHECK(res == 8);
+        REQUIRE(max_running.load() <= 3);
+    }
+
+    SECTION("Stream rejects with the first rejection") {
+        int res = 0;
+
+        std::vector<std::function<pro::promise<int>()>> v;
+        v.emplace_back([] { return pro::make_promise<int>(returnInt, 115); });
+        v.emplace_back([] { return pro::make_promise<int>([]()->int { throw 666; }); });
+        v.emplace_back([] { return pro::make_promise<int>(returnInt, 420); });
+
+        pro::PromiseAllStream(v, 1, [&res](unsigned int, int value) {
+            res += value;
+        }).fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (int i) {
+                res += i;
+            }
+        });
+
+        REQUIRE(res == 115 + 666);
+    }
+
+    SECTION("Empty collection resolves") {
+        int res = 0;
+
+        std::vector<std::function<pro::promise<int>()>> v;
+        pro::PromiseAllStream(v, 4, [&res](unsigned int, int) { res = -1; })
+            .then([&res]() { res = 115; });
+
+        REQUIRE(res == 115);
+    }
+}
+TEST_CASE("PromiseReduce", "[util]")
+{
+    SECTION("Values are folded as they arrive") {
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        for (int i = 1; i <= 32; ++i) {
+            v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, i % 4, i));
+        }
+
+        pro::PromiseReduce(v, 0, std::plus<int>()).then([&res](int sum) { res = sum; });
+
+        REQUIRE(res == 32 * 33 / 2);
+    }
+
+    SECTION("Non-numeric values are folded with the given operation") {
+        size_t res = 0;
+
+        std::vector<pro::promise<std::string>> v;
+        v.emplace_back(pro::make_promise<std::string>([]()->std::string { return "AB"; }));
+        v.emplace_back(pro::make_promise<std::string>([]()->std::string { return "CDE"; }));
+
+        pro::PromiseReduce(v, std::string(), std::plus<std::string>()).then(
+            [&res](std::string s) { res = s.size(); }
+        );
+
+        REQUIRE(res == 5);
+    }
+
+    SECTION("Empty collection yields the initial value") {
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        pro::PromiseReduce(v, 115, std::plus<int>()).then([&res](int sum) { res = sum; });
+
+        REQUIRE(res == 115);
+    }
+
+    SECTION("PromiseReduce rejects with the first rejection") {
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>(returnInt, 115));
+        v.emplace_back(pro::make_promise<int>([]()->int { throw 666; }));
+
+        pro::PromiseReduce(v, 0, std::plus<int>()).then(
+            [&res](int sum) { res = sum; },
+            [&res](int rejection) { res = -rejection; }
+        );
+
+        REQUIRE(res == -666);
+    }
+
+    SECTION("Values are folded on the executor's workers") {
+        pro::executor ex(2);
+        std::atomic<int> outside = 0;
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        for (int i = 1; i <= 16; ++i) {
+            v.emplace_back(pro::make_promise<int>(returnInt, i));
+        }
+
+        pro::PromiseReduce(v, 0, [&ex, &outside](int a, int b) {
+            if (ex.worker_index() < 0)
+                ++outside;
+            return a + b;
+        }, ex).then([&res](int sum) { res = sum; });
+
+        REQUIRE(res == 16 * 17 / 2);
+        //only the final combine of the partials runs off the pool
+        CHECK(outside <= 2);
+        CHECK(ex.worker_index() == -1);
+    }
+}
+TEST_CASE("PromiseSome", "[util]")
+{
+    SECTION("PromiseSome resolves with the k fastest values and their indices") {
+        std::vector<std::pair<unsigned int, int>> res;
+
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, 300, 115));
+        v.emplace_back(pro::make_promise<int>(returnInt, 666));
+        v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, 50, 420));
+
+        pro::PromiseSome(v, 2).then([&res](auto winners) { res = winners; });
+
+        REQUIRE(res.size() == 2);
+        REQUIRE(res[0] == std::make_pair(1u, 666));
+        REQUIRE(res[1] == std::make_pair(2u, 420));
+    }
+
+    SECTION("PromiseSome does not wait for the remaining promises") {
+        auto start = std::chrono::system_clock::now();
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>(returnInt, 115));
+        v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, 500, 666));
+
+        pro::PromiseSome(v, 1).then([&res](auto winners) { res = winners[0].second; });
+
+        auto end = std::chrono::system_clock::now();
+        REQUIRE(res == 115);
+        REQUIRE(200 > std::chrono::duration_cast <std::chrono::milliseconds> (end - start).count());
+    }
+
+    SECTION("PromiseSome fails fast when the quorum is out of reach") {
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>([]()->int { throw 115; }));
+        v.emplace_back(pro::make_promise<int>([]()->int { throw std::exception(""); }));
+        v.emplace_back(pro::make_promise<int>(sleepAndReturnInt, 300, 666));
+
+        pro::PromiseSome(v, 2).fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (pro::AggregateException& aggr) {
+                res = (int)aggr.inner_exceptions.size();
+            }
+        });
+
+        REQUIRE(res == 2);
+    }
+
+    SECTION("PromiseSome fails when k exceeds the collection size") {
+        int res = 0;
+
+        std::vector<pro::promise<int>> v;
+        v.emplace_back(pro::make_promise<int>(returnInt, 115));
+
+        pro::PromiseSome(v, 2).fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (std::range_error&) {
+                res = 1;
+            }
+        });
+
+        REQUIRE(res == 1);
+    }
+}
+TEST_CASE("hedge", "[util]")
+{
+    SECTION("A fast attempt resolves without a backup") {
+        std::atomic<int> attempts = 0;
+        int res = 0;
+
+        pro::hedge([&attempts] {
+            ++attempts;
+            return pro::make_promise<int>(returnInt, 115);
+        }, std::chrono::milliseconds(200), 3).then([&res](int i) { res = i; });
+
+        REQUIRE(res == 115);
+        REQUIRE(attempts == 1);
+    }
+
+    SECTION("A slow attempt is hedged by a backup and the first success wins") {
+        auto start = std::chrono::system_clock::now();
+        std::atomic<int> attempts = 0;
+        int res = 0;
+
+        pro::hedge([&attempts] {
+            int attempt = attempts++;
+            return pro::make_promise<int>(sleepAndReturnInt, attempt == 0 ? 500 : 10, attempt);
+        }, std::chrono::milliseconds(50), 2).then([&res](int i) { res = i; });
+
+        auto end = std::chrono::system_clock::now();
+        REQUIRE(res == 1);
+        REQUIRE(attempts == 2);
+        REQUIRE(400 > std::chrono::duration_cast <std::chrono::milliseconds> (end - start).count());
+    }
+
+    SECTION("A failed attempt starts the next one right away") {
+        std::atomic<int> attempts = 0;
+        int res = 0;
+
+        pro::hedge([&attempts]() {
+            if (attempts++ == 0)
+                return pro::make_promise<int>([]()->int { throw 666; });
+            return pro::make_promise<int>(returnInt, 420);
+        }, std::chrono::seconds(10), 2).then([&res](int i) { res = i; });
+
+        REQUIRE(res == 420);
+    }
+
+    SECTION("Hedge rejects when all attempts fail") {
+        int res = 0;
+
+        pro::hedge([] {
+            return pro::make_promise<int>([]()->int { throw 666; });
+        }, std::chrono::milliseconds(10), 3).then(
+            [&res](int i) { res = i; },
+            [&res](int i) { res = -i; }
+        );
+
+        REQUIRE(res == -666);
+    }
+
+    SECTION("Adaptive delay follows the observed latency percentile") {
+        pro::latency_percentile tracker(0.5, std::chrono::milliseconds(100));
+        REQUIRE(tracker.delay() == std::chrono::milliseconds(100));
+
+        tracker.record(std::chrono::milliseconds(10));
+        tracker.record(std::chrono::milliseconds(20));
+        tracker.record(std::chrono::milliseconds(30));
+        REQUIRE(tracker.delay() == std::chrono::milliseconds(20));
+
+        int res = 0;
+        pro::hedge([] { return pro::make_promise<int>(returnInt, 115); }, tracker, 2)
+            .then([&res](int i) { res = i; });
+        REQUIRE(res == 115);
+    }
+}
+TEST_CASE("retry", "[util]")
+{
+    SECTION("Failed attempts are retried until one succeeds") {
+        std::atomic<int> attempts = 0;
+        int res = 0;
+
+        pro::retry_policy<int> policy;
+        policy.max_attempts = 5;
+        policy.initial_delay = std::chrono::milliseconds(5);
+
+        pro::retry([&attempts]() {
+            if (++attempts < 3)
+                return pro::make_promise<int>([]()->int { throw 666; });
+            return pro::make_promise<int>(returnInt, 115);
+        }, policy).then([&res](int i) { res = i; });
+
+        REQUIRE(res == 115);
+        REQUIRE(attempts == 3);
+    }
+
+    SECTION("Retry rejects with the last reason after max attempts") {
+        std::atomic<int> attempts = 0;
+        int res = 0;
+
+        pro::retry_policy<int> policy;
+        policy.max_attempts = 3;
+        policy.initial_delay = std::chrono::milliseconds(1);
+
+        pro::retry([&attempts]() {
+            int attempt = ++attempts;
+            return pro::make_promise<int>([attempt]()->int { throw attempt; });
+        }, policy).then(
+            [&res](int i) { res = i; },
+            [&res](int i) { res = -i; }
+        );
+
+        REQUIRE(res == -3);
+        REQUIRE(attempts == 3);
+    }
+
+    SECTION("Predicates stop retrying") {
+        std::atomic<int> attempts = 0;
+        int res = 0;
+
+        pro::retry_policy<int> policy;
+        policy.initial_delay = std::chrono::milliseconds(1);
+        policy.retry_on_rejection = [](const int& code) { return code != 404; };
+        policy.retry_on_exception = [](std::exception_ptr) { return false; };
+
+        pro::retry([&attempts]() {
+            ++attempts;
+            return pro::make_promise<int>([]()->int { throw 404; });
+        }, policy).fail([&res](int i) { res = i; }, [&res](std::exception_ptr) { res = -1; });
+
+        REQUIRE(res == 404);
+        REQUIRE(attempts == 1);
+    }
+
+    SECTION("Backoff grows exponentially up to the max delay") {
+        pro::retry_policy<int> policy;
+        policy.initial_delay = std::chrono::milliseconds(10);
+        policy.multiplier = 2.0;
+        policy.max_delay = std::chrono::milliseconds(50);
+
+        REQUIRE(policy.delay_for(1) == std::chrono::milliseconds(10));
+        REQUIRE(policy.delay_for(2) == std::chrono::milliseconds(20));
+        REQUIRE(policy.delay_for(3) == std::chrono::milliseconds(40));
+        REQUIRE(policy.delay_for(4) == std::chrono::milliseconds(50));
+
+        policy.jitter = 0.5;
+        REQUIRE(policy.delay_for(2) <= std::chrono::milliseconds(20));
+        REQUIRE(policy.delay_for(2) >= std::chrono::milliseconds(10));
+    }
+}
+TEST_CASE("singleflight", "[util]")
+{
+    SECTION("Concurrent callers for a key share one request") {
+        pro::singleflight<std::string, int> flights;
+        std::atomic<int> started = 0;
+        int res = 0;
+
+        auto factory = [&started] {
+            ++started;
+            return pro::make_promise<int>(sleepAndReturnInt, 100, 115);
+        };
+
+        auto p1 = flights.get("key", factory);
+        auto p2 = flights.get("key", factory);
+        auto p3 = flights.get("other", factory);
+
+        CHECK(flights.in_flight() == 2);
+        p1.then([&res](int i) { res += i; });
+        p2.then([&res](int i) { res += i; });
+        p3.then([&res](int i) { res += i; });
+
+        REQUIRE(res == 115 * 3);
+        REQUIRE(started == 2);
+        REQUIRE(flights.coalesced() == 1);
+    }
+
+    SECTION("A settled key is forgotten") {
+        pro::singleflight<int, int> flights;
+        std::atomic<int> started = 0;
+        int res = 0;
+
+        auto factory = [&started] {
+            return pro::make_promise<int>(returnInt, ++started);
+        };
+
+        flights.get(1, factory).then([&res](int i) { res += i; });
+        flights.get(1, factory).then([&res](int i) { res += i; });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(res == 1 + 2);
+        REQUIRE(flights.in_flight() == 0);
+    }
+
+    SECTION("Rejections are shared with every caller") {
+        pro::singleflight<int, int> flights;
+        int res = 0;
+
+        auto factory = [] {
+            return pro::make_promise<int>([]()->int {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                throw 666;
+            });
+        };
+
+        auto p1 = flights.get(1, factory);
+        auto p2 = flights.get(1, factory);
+        p1.then([&res](int i) { res += i; }, [&res](int i) { res -= i; });
+        p2.then([&res](int i) { res += i; }, [&res](int i) { res -= i; });
+
+        REQUIRE(res == -666 * 2);
+    }
+}
+TEST_CASE("async_cache", "[util]")
+{
+    SECTION("A settled entry is served without calling the loader") {
+        std::atomic<int> loads = 0;
+        int res = 0;
+
+        pro::async_cache<int, int> cache([&loads](const int& key) {
+            ++loads;
+            return pro::make_promise<int>(returnInt, key * 2);
+        });
+
+        cache.get(115).then([&res](int i) { res += i; });
+        cache.get(115).then([&res](int i) { res += i; });
+
+        REQUIRE(res == 115 * 4);
+        REQUIRE(loads == 1);
+        REQUIRE(cache.stats().hits == 1);
+        REQUIRE(cache.stats().misses == 1);
+    }
+
+    SECTION("The loader runs on the executor") {
+        pro::executor ex(1);
+        pro::async_cache<int, int>::options opts;
+        opts.ex = &ex;
+
+        std::thread::id loader_thread;
+        pro::async_cache<int, int> cache([&loader_thread](const int& key) {
+            loader_thread = std::this_thread::get_id();
+            return pro::make_promise<int>(returnInt, key);
+        }, opts);
+
+        int res = 0;
+        cache.get(115).then([&res](int i) { res = i; });
+
+        REQUIRE(res == 115);
+        REQUIRE(loader_thread != std::thread::id());
+        REQUIRE(loader_thread != std::this_thread::get_id());
+    }
+
+    SECTION("A pending entry is shared with the next callers") {
+        std::atomic<int> loads = 0;
+        int res = 0;
+
+        pro::async_cache<int, int> cache([&loads](const int& key) {
+            ++loads;
+            return pro::make_promise<int>(sleepAndReturnInt, 100, key);
+        });
+
+        auto p1 = cache.get(1);
+        auto p2 = cache.get(1);
+        p1.then([&res](int i) { res += i; });
+        p2.then([&res](int i) { res += i; });
+
+        REQUIRE(res == 2);
+        REQUIRE(loads == 1);
+        REQUIRE(cache.stats().coalesced == 1);
+    }
+
+    SECTION("The least recently used entry is evicted") {
+        std::atomic<int> loads = 0;
+
+        pro::async_cache<int, int>::options opts;
+        opts.capacity = 2;
+        opts.shards = 1;
+        pro::async_cache<int, int> cache([&loads](const int& key) {
+            ++loads;
+            return pro::make_promise<int>(returnInt, key);
+        }, opts);
+
+        cache.get(1).then(dummyHandler);
+        cache.get(2).then(dummyHandler);
+        cache.get(1).then(dummyHandler);
+        cache.get(3).then(dummyHandler);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.stats().evictions == 1);
+        cache.get(1).then(dummyHandler);
+        REQUIRE(loads == 3);
+        cache.get(2).then(dummyHandler);
+        REQUIRE(loads == 4);
+    }
+
+    SECTION("Expired entries are loaded again") {
+        std::atomic<int> loads = 0;
+
+        pro::async_cache<int, int>::options opts;
+        opts.ttl = std::chrono::milliseconds(20);
+        pro::async_cache<int, int> cache([&loads](const int& key) {
+            return pro::make_promise<int>(returnInt, ++loads);
+        }, opts);
+
+        int res = 0;
+        cache.get(1).then([&res](int i) { res = i; });
+        REQUIRE(res == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        cache.get(1).then([&res](int i) { res = i; });
+        REQUIRE(res == 2);
+    }
+
+    SECTION("Typed rejections are cached only when asked to") {
+        std::atomic<int> loads = 0;
+        int res = 0;
+
+        auto loader = [&loads](const int& key) {
+            ++loads;
+            return pro::make_promise<int>([]()->int { throw 404; });
+        };
+
+        pro::async_cache<int, int> cache(loader);
+        cache.get(1).fail([&res](int i) { res = i; }, dummyHandler);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        cache.get(1).fail([&res](int i) { res += i; }, dummyHandler);
+        REQUIRE(res == 404 * 2);
+        REQUIRE(loads == 2);
+
+        pro::async_cache<int, int>::options opts;
+        opts.negative_ttl = std::chrono::seconds(10);
+        pro::async_cache<int, int> negative_cache(loader, opts);
+        negative_cache.get(1).fail([&res](int i) { res = i; }, dummyHandler);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        negative_cache.get(1).fail([&res](int i) { res += i; }, dummyHandler);
+        REQUIRE(res == 404 * 2);
+        REQUIRE(loads == 3);
+    }
+}
+TEST_CASE("batcher", "[util]")
+{
+    SECTION("Keys requested within a tick are loaded with one batch") {
+        std::atomic<int> batches = 0;
+        int res = 0;
+
+        pro::batcher<int, int> loader([&batches](std::vector<int> keys) {
+            ++batches;
+            return pro::make_promise<std::vector<int>>([keys]() {
+                std::vector<int> values;
+                for (int key : keys)
+                    values.push_back(key * 10);
+                return values;
+            });
+        }, 64, std::chrono::milliseconds(20));
+
+        auto p1 = loader.load(1);
+        auto p2 = loader.load(2);
+        auto p3 = loader.load(3);
+        p1.then([&res](int i) { res += i; });
+        p2.then([&res](int i) { res += i; });
+        p3.then([&res](int i) { res += i; });
+
+        REQUIRE(res == 60);
+        REQUIRE(batches == 1);
+    }
+
+    SECTION("A full batch is dispatched without waiting for the tick") {
+        auto start = std::chrono::system_clock::now();
+        std::vector<size_t> sizes;
+        int res = 0;
+
+        pro::batcher<int, int> loader([&sizes](std::vector<int> keys) {
+            sizes.push_back(keys.size());
+            return pro::promise<std::vector<int>>(std::vector<int>(keys.size(), 1));
+        }, 2, std::chrono::seconds(10));
+
+        auto p1 = loader.load(1);
+        auto p2 = loader.load(2);
+        p1.then([&res](int i) { res += i; });
+        p2.then([&res](int i) { res += i; });
+
+        auto end = std::chrono::system_clock::now();
+        REQUIRE(res == 2);
+        REQUIRE(sizes == std::vector<size_t>{ 2 });
+        REQUIRE(1000 > std::chrono::duration_cast <std::chrono::milliseconds> (end - start).count());
+    }
+
+    SECTION("A rejected batch rejects every key") {
+        int res = 0;
+
+        pro::batcher<int, int> loader([](std::vector<int> keys) {
+            return pro::make_promise<std::vector<int>>([]()->std::vector<int> { throw std::exception("backend"); });
+        });
+
+        auto p1 = loader.load(1);
+        auto p2 = loader.load(2);
+        p1.fail([&res](std::exception_ptr) { res += 1; });
+        p2.fail([&res](std::exception_ptr) { res += 1; });
+
+        REQUIRE(res == 2);
+    }
+
+    SECTION("Mismatched batch results reject the keys") {
+        int res = 0;
+
+        pro::batcher<int, int> loader([](std::vector<int> keys) {
+            return pro::promise<std::vector<int>>(std::vector<int>{ 1 });
+        });
+
+        auto p1 = loader.load(1);
+        auto p2 = loader.load(2);
+        loader.flush();
+        p1.fail([&res](std::exception_ptr) { res += 1; });
+        p2.fail([&res](std::exception_ptr) { res += 1; });
+
+        REQUIRE(res == 2);
+    }
+
+    SECTION("A key requested twice in a batch is loaded once") {
+        std::vector<int> loaded;
+        int res = 0;
+
+        pro::batcher<int, int> loader([&loaded](std::vector<int> keys) {
+            loaded = keys;
+            return pro::promise<std::vector<int>>(keys);
+        }, 3, std::chrono::seconds(10));
+
+        auto p1 = loader.load(1);
+        auto p2 = loader.load(1);
+        auto p3 = loader.load(2);
+        auto p4 = loader.load(3);
+        p1.then([&res](int i) { res += i; });
+        p2.then([&res](int i) { res += i; });
+        p3.then([&res](int i) { res += i; });
+        p4.then([&res](int i) { res += i; });
+
+        REQUIRE(loaded == std::vector<int>{ 1, 2, 3 });
+        REQUIRE(res == 1 + 1 + 2 + 3);
+    }
+
+    SECTION("The timer of a dispatched batch does not flush the next one") {
+        std::vector<size_t> sizes;
+
+        pro::batcher<int, int> loader([&sizes](std::vector<int> keys) {
+            sizes.push_back(keys.size());
+            return pro::promise<std::vector<int>>(keys);
+        }, 2, std::chrono::milliseconds(100));
+
+        auto p1 = loader.load(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        auto p2 = loader.load(2);
+        auto p3 = loader.load(3);
+        p1.then([](int) {});
+        p2.then([](int) {});
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        REQUIRE(sizes == std::vector<size_t>{ 2 });
+        p3.then([](int) {});
+        REQUIRE(sizes == std::vector<size_t>{ 2, 1 });
+    }
+}
+TEST_CASE("shared_promise", "[basic]")
+{
+    SECTION("Every consumer receives the same value") {
+        std::atomic<int> res = 0;
+
+        pro::shared_promise<int> sp(pro::make_promise<int>(sleepAndReturnInt, 50, 115));
+        pro::shared_promise<int> copy = sp;
+
+        std::vector<pro::promise<void>> consumers;
+        for (int i = 0; i < 10; ++i) {
+            consumers.push_back(sp.then([&res](const int& i) { res += i; }));
+        }
+        consumers.push_back(copy.then([&res](const int& i) { res += i; }));
+
+        CHECK(sp.consumers() == 11);
+        for (auto& consumer : consumers) {
+            consumer.then([] {});
+        }
+        REQUIRE(res == 115 * 11);
+    }
+
+    SECTION("Continuations are chainable and attach after the settlement too") {
+        float res = 0;
+
+        pro::shared_promise<int> sp(pro::make_promise<int>(returnInt, 2));
+        sp.then([](const int& i) { return i * 1.5f; }).then([&res](float f) { res = f; });
+        REQUIRE(res == 3.0f);
+
+        REQUIRE(sp.settled());
+        sp.then([&res](const int& i) { res += i; });
+        REQUIRE(res == 5.0f);
+    }
+
+    SECTION("Values are not copied per consumer") {
+        int copied_res = -1;
+
+        pro::shared_promise<CopyCounter> sp(pro::make_promise<CopyCounter>(returnCounter));
+        sp.then([](const CopyCounter&) {});
+        sp.then([&copied_res](const CopyCounter& cc) { copied_res = cc.copied; }).then([] {});
+
+        REQUIRE(copied_res == 0);
+    }
+
+    SECTION("Rejections reach every consumer") {
+        int res = 0;
+
+        pro::shared_promise<int> sp(pro::make_promise<int>([]()->int { throw 666; }));
+        sp.then([&res](const int& i) { res += i; }, [&res](const int& i) { res -= i; }).then([] {});
+        sp.then([&res](const int& i) { res += i; }).fail([&res](std::exception_ptr) { res -= 1; });
+        sp.fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (int i) {
+                res -= i;
+            }
+        }).then([] {});
+
+        REQUIRE(res == -666 * 2 - 1);
+    }
+
+    SECTION("Exceptions are passed to the exception callback") {
+        int res = 0;
+
+        pro::shared_promise<int> sp(pro::make_promise<int>([]()->int { throw std::exception("ex"); }));
+        sp.then(
+            [&res](const int&) { res = 1; },
+            [&res](const int&) { res = 2; },
+            [&res](std::exception_ptr) { res = 3; }
+        ).then([] {});
+
+        REQUIRE(res == 3);
+    }
+
+    SECTION("Exceptions thrown by the callback reach the exception callback") {
+        int res = 0;
+
+        pro::shared_promise<int> sp(pro::make_promise<int>(returnInt, 2));
+        sp.then(
+            [](const int&) { throw std::exception("callback"); },
+            [&res](const int&) { res = 2; },
+            [&res](std::exception_ptr) { res = 3; }
+        ).then([] {});
+
+        REQUIRE(res == 3);
+    }
+
+    SECTION("fail() splits rejections from exceptions and throws when fulfilled") {
+        int res = 0;
+
+        pro::shared_promise<int> rejected(pro::make_promise<int>([]()->int { throw 666; }));
+        rejected.fail([&res](const int& i) { res += i; }, [&res](std::exception_ptr) { res = -1; }).then([] {});
+        REQUIRE(res == 666);
+
+        pro::shared_promise<int> failed(pro::make_promise<int>([]()->int { throw std::exception("ex"); }));
+        failed.fail([&res](const int& i) { res += i; }, [&res](std::exception_ptr) { res = -1; }).then([] {});
+        REQUIRE(res == -1);
+
+        pro::shared_promise<int> fulfilled(pro::make_promise<int>(returnInt, 2));
+        std::future<void> single = fulfilled.fail([](std::exception_ptr) {});
+        std::future<void> split = fulfilled.fail([](const int&) {}, [](std::exception_ptr) {});
+        REQUIRE_THROWS_AS(single.get(), std::logic_error);
+        REQUIRE_THROWS_AS(split.get(), std::logic_error);
+    }
+}
+TEST_CASE("task_graph", "[util]")
+{
+    SECTION("Nodes run after their dependencies") {
+        std::mutex mutex;
+        std::vector<int> order;
+        auto record = [&](int i) { return [&, i] { std::lock_guard<std::mutex> lock(mutex); order.push_back(i); }; };
+
+        pro::executor ex(4);
+        pro::task_graph graph;
+        auto a = graph.add(record(0));
+        auto b = graph.add(record(1), { a });
+        auto c = graph.add(record(2), { a });
+        graph.add(record(3), { b, c });
+
+        graph.run(ex).then([] {});
+
+        REQUIRE(order.size() == 4);
+        CHECK(order.front() == 0);
+        CHECK(order.back() == 3);
+    }
+
+    SECTION("Critical path is the longest cost-weighted chain") {
+        pro::task_graph graph;
+        auto a = graph.add([] {}, {}, 1);
+        auto b = graph.add([] {}, { a }, 10);
+        auto c = graph.add([] {}, { a }, 2);
+        graph.add([] {}, { b, c }, 3);
+
+        CHECK(graph.critical_path(a) == 14);
+        CHECK(graph.critical_path(c) == 5);
+        CHECK_THROWS_AS(graph.add([] {}, { 7 }), std::invalid_argument);
+    }
+
+    SECTION("The graph can be run repeatedly") {
+        std::atomic<int> res = 0;
+
+        pro::task_graph graph;
+        auto a = graph.add([&res] { res += 1; });
+        graph.add([&res] { res += 10; }, { a });
+
+        graph.run().then([] {});
+        graph.run().then([] {});
+        REQUIRE(res == 22);
+
+        bool empty_ran = false;
+        pro::task_graph().run().then([&empty_ran] { empty_ran = true; });
+        REQUIRE(empty_ran);
+    }
+
+    SECTION("A failing node skips its dependents and rejects the run") {
+        std::atomic<int> res = 0;
+
+        pro::task_graph graph;
+        auto a = graph.add([&res] { res += 1; });
+        auto b = graph.add([] { throw 115; }, { a });
+        graph.add([&res] { res += 100; }, { b });
+
+        graph.run().fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (int i) {
+                res += i;
+            }
+        });
+
+        REQUIRE(res == 116);
+    }
+}
+TEST_CASE("task_graph instance", "[util]")
+{
+    SECTION("An instance replays the recorded graph") {
+        std::atomic<int> res = 0;
+
+        pro::executor ex(4);
+        pro::task_graph graph;
+        auto a = graph.add([&res] { res += 1; });
+        auto b = graph.add([&res] { res += 10; }, { a });
+        auto c = graph.add([&res] { res += 100; }, { a });
+        graph.add([&res] { res += 1000; }, { b, c });
+
+        auto recorded = graph.instantiate(ex);
+        for (int i = 0; i < 3; ++i) {
+            recorded.launch();
+            recorded.wait();
+        }
+        REQUIRE(res == 3333);
+
+        recorded.run().then([] {});
+        REQUIRE(res == 4444);
+        CHECK(recorded.size() == 4);
+    }
+
+    SECTION("A failed run is reported and the next one starts clean") {
+        std::atomic<int> res = 0;
+        std::atomic<bool> fail = true;
+
+        pro::task_graph graph;
+        auto a = graph.add([&fail] { if (fail) throw 115; });
+        graph.add([&res] { res += 1; }, { a });
+
+        auto recorded = graph.instantiate();
+        recorded.launch();
+        CHECK_THROWS_AS(recorded.wait(), int);
+        REQUIRE(res == 0);
+
+        fail = false;
+        recorded.launch();
+        recorded.wait();
+        REQUIRE(res == 1);
+    }
+}
+TEST_CASE("promise allocator", "[basic]")
+{
+    SECTION("The shared state is allocated from the memory resource") {
+        CountingResource resource;
+        int res = 0;
+
+        {
+            auto p = pro::make_promise<int>(&resource, returnInt, 115);
+            p.then([&res](int i) { res = i; });
+        }
+
+        REQUIRE(res == 115);
+        CHECK(resource.allocated > 0);
+        CHECK(resource.allocated == resource.deallocated);
+    }
+
+    SECTION("Void promises and rejections with an allocator") {
+        CountingResource resource;
+        std::pmr::polymorphic_allocator<std::byte> alloc(&resource);
+        int res = 0;
+
+        pro::promise<void> p(std::allocator_arg, alloc, dummy);
+        p.then([&res] { res += 1; });
+
+        pro::promise<int> rejected(std::allocator_arg, alloc, []() -> int { throw 114; });
+        rejected.then([](int i) { return i; }, [&res](int i) { res += i; return 0; });
+
+        REQUIRE(res == 115);
+        CHECK(resource.allocated >= 2);
+    }
+
+    SECTION("A promise joins its method before the arena goes away") {
+        std::atomic<bool> finished = false;
+        {
+            std::pmr::monotonic_buffer_resource arena;
+            auto p = pro::make_promise<int>(&arena, [&finished]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                finished = true;
+                return 1;
+            });
+        }
+        REQUIRE(finished);
+    }
+
+    SECTION("Resolving an allocator promise early does not wait for its method") {
+        int res = 0;
+        auto start = std::chrono::system_clock::now();
+        {
+            auto p = pro::make_promise<int>(std::pmr::new_delete_resource(), sleepAndReturnInt, 200, 666);
+            p.resolve(420);
+            p.then([&res](int i) { res = i; });
+        }
+
+        auto end = std::chrono::system_clock::now();
+        REQUIRE(res == 420);
+        REQUIRE(100 > std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+    }
+
+    SECTION("A request arena holds the queue bookkeeping") {
+        CountingResource resource;
+        {
+            std::pmr::monotonic_buffer_resource arena(&resource);
+            pro::concurrency::queue<int, std::pmr::polymorphic_allocator<int>> q(&arena);
+
+            for (int i = 0; i < 100; ++i)
+                q.push(std::move(i));
+            REQUIRE(q.size() == 100);
+            REQUIRE(q.pop() == 0);
+            CHECK(resource.allocated > 0);
+        }
+        CHECK(resource.allocated == resource.deallocated);
+    }
+}
+TEST_CASE("recycling_resource", "[util]")
+{
+    auto& resource = pro::recycling_resource::instance();
+
+    SECTION("A freed block is reused by the same thread") {
+        auto before = resource.stats();
+
+        void* p1 = resource.allocate(48);
+        resource.deallocate(p1, 48);
+        void* p2 = resource.allocate(40);
+        resource.deallocate(p2, 40);
+
+        auto after = resource.stats();
+        REQUIRE(p1 == p2);
+        CHECK(after.allocations - before.allocations == 2);
+        CHECK(after.hits - before.hits >= 1);
+        CHECK(after.deallocations - before.deallocations == 2);
+    }
+
+    SECTION("Blocks freed by another thread return to their owner") {
+        auto before = resource.stats();
+
+        std::vector<void*> blocks;
+        for (int i = 0; i < 10; ++i)
+            blocks.push_back(resource.allocate(200));
+
+        std::thread([&] {
+            for (void* p : blocks)
+                resource.deallocate(p, 200);
+        }).join();
+
+        void* p = resource.allocate(200);
+        bool reused = std::find(blocks.begin(), blocks.end(), p) != blocks.end();
+        resource.deallocate(p, 200);
+
+        auto after = resource.stats();
+        REQUIRE(reused);
+        CHECK(after.remote_frees - before.remote_frees == 10);
+        CHECK(after.hit_rate() > 0.0);
+    }
+
+    SECTION("Promise shared states are recycled") {
+        int res = 0;
+        auto before = resource.stats();
+
+        for (int i = 0; i < 5; ++i) {
+            auto p = pro::make_promise<int>(&resource, returnInt, i);
+            p.then([&res](int i) { res += i; });
+        }
+
+        auto after = resource.stats();
+        REQUIRE(res == 10);
+        CHECK(after.allocations - before.allocations >= 5);
+        CHECK(after.hits - before.hits > 0);
+    }
+
+    SECTION("The library's own states come from the resource") {
+        std::atomic<int> res = 0;
+        pro::executor ex(1);
+        auto before = resource.stats();
+
+        for (int i = 0; i < 5; ++i)
+            ex.run<int>(returnInt, i).then([&res](int i) { res += i; });
+
+        pro::shared_promise<int> shared(pro::make_promise<int>(returnInt, 1));
+        for (int i = 0; i < 5; ++i)
+            shared.then([&res](const int& i) { res += i; }).then([] {});
+
+        auto after = resource.stats();
+        REQUIRE(res == 15);
+        CHECK(after.allocations - before.allocations >= 10);
+        CHECK(after.hits - before.hits > 0);
+    }
+}
+TEST_CASE("pipeline", "[util]")
+{
+    SECTION("Items flow through every stage into the sink") {
+        std::atomic<int> res = 0;
+        std::vector<int> v{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+        pro::executor ex(4);
+        auto p = pro::source(v)
+            | pro::stage([](int i) { return i * 2; }, 4)
+            | pro::stage([](int i) { return std::to_string(i); }, 1)
+            | pro::sink([&res](std::string s) { res += std::stoi(s); });
+
+        p.run(ex).then([] {});
+        REQUIRE(res == 110);
+
+        p.run(ex).then([] {});
+        REQUIRE(res == 220);
+    }
+
+    SECTION("Stages do not exceed their concurrency") {
+        std::atomic<int> running = 0;
+        std::atomic<int> peak = 0;
+        std::atomic<int> consumed = 0;
+        int next = 0;
+
+        pro::executor ex(8);
+        auto p = pro::source([&next]() -> std::optional<int> {
+                if (next == 50)
+                    return std::nullopt;
+                return next++;
+            })
+            | pro::stage([&](int i) {
+                int now = ++running;
+                int seen = peak.load();
+                while (now > seen && !peak.compare_exchange_weak(seen, now));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                --running;
+                return i;
+            }, 3, 2)
+            | pro::sink([&consumed](int) { ++consumed; });
+
+        p.run(ex).then([] {});
+        REQUIRE(consumed == 50);
+        CHECK(peak <= 3);
+    }
+
+    SECTION("A slow sink holds back the stages") {
+        std::atomic<int> produced = 0;
+        std::atomic<int> max_ahead = 0;
+        std::atomic<int> consumed = 0;
+
+        pro::executor ex(4);
+        auto p = pro::source(std::vector<int>(40, 1))
+            | pro::stage([&](int i) {
+                int ahead = ++produced - consumed;
+                int seen = max_ahead.load();
+                while (ahead > seen && !max_ahead.compare_exchange_weak(seen, ahead));
+                return i;
+            }, 2, 2)
+            | pro::sink([&consumed](int) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                ++consumed;
+            }, 1, 2);
+
+        p.run(ex).then([] {});
+        REQUIRE(consumed == 40);
+        //sink queue, the sink itself and the outputs parked in the stage
+        CHECK(max_ahead <= 2 + 1 + 2 + 1);
+    }
+
+    SECTION("The first failure rejects the run") {
+        std::atomic<int> consumed = 0;
+        int res = 0;
+
+        auto p = pro::source(std::vector<int>{ 1, 2, 3, 115, 4 })
+            | pro::stage([](int i) { if (i == 115) throw i; return i; })
+            | pro::sink([&consumed](int) { ++consumed; });
+
+        p.run().fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (int i) {
+                res = i;
+            }
+        });
+
+        REQUIRE(res == 115);
+        CHECK(consumed <= 3);
+
+        bool empty_done = false;
+        (pro::source(std::vector<int>()) | pro::sink([](int) {})).run().then([&empty_done] { empty_done = true; });
+        REQUIRE(empty_done);
+    }
+}
+TEST_CASE("channel", "[util]")
+{
+    SECTION("Items are received in the order they were sent") {
+        pro::channel<int> ch(2);
+        int res = 0;
+
+        ch.send(1).then([] {});
+        ch.send(2).then([] {});
+        REQUIRE(ch.size() == 2);
+
+        ch.receive().then([&res](int i) { res = res * 10 + i; });
+        ch.receive().then([&res](int i) { res = res * 10 + i; });
+        REQUIRE(res == 12);
+        CHECK(ch.size() == 0);
+    }
+
+    SECTION("A sender waits for room and a receiver for an item") {
+        pro::channel<int> ch(1);
+        std::atomic<int> res = 0;
+
+        REQUIRE(ch.send(1).valid());
+        auto pending_send = ch.send(2).then([&res] { res += 100; });
+        CHECK(res == 0);
+
+        ch.receive().then([&res](int i) { res += i; });
+        ch.receive().then([&res](int i) { res += i; });
+        pending_send.then([] {});
+        REQUIRE(res == 103);
+
+        auto pending_receive = ch.receive().then([&res](int i) { res += i; });
+        ch.send(12).then([] {});
+        pending_receive.then([] {});
+        REQUIRE(res == 115);
+    }
+
+    SECTION("Unbuffered channel hands items over directly") {
+        pro::channel<std::string> ch(0);
+        std::string res;
+
+        auto pending_receive = ch.receive().then([&res](std::string s) { res = s; });
+        REQUIRE(ch.try_send("direct"));
+        pending_receive.then([] {});
+        REQUIRE(res == "direct");
+
+        std::string item = "none";
+        CHECK_FALSE(ch.try_send(std::move(item)));
+        CHECK(item == "none");
+        CHECK_FALSE(ch.try_receive().has_value());
+    }
+
+    SECTION("Closing rejects waiting and later operations") {
+        pro::channel<int> ch(1);
+        std::atomic<int> rejected = 0;
+        int res = 0;
+
+        ch.send(115).then([] {});
+        auto pending_send = ch.send(1).fail([&rejected](std::exception_ptr) { ++rejected; });
+        ch.close();
+        pending_send.then([] {});
+
+        ch.receive().then([&res](int i) { res = i; });
+        REQUIRE(res == 115);
+
+        ch.receive().fail([&rejected](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (pro::ChannelClosedException&) {
+                ++rejected;
+            }
+        });
+        ch.send(2).fail([&rejected](std::exception_ptr) { ++rejected; });
+
+        REQUIRE(rejected == 3);
+        CHECK(ch.is_closed());
+    }
+}
+TEST_CASE("async_mutex", "[util]")
+{
+    SECTION("Only one holder of the mutex at a time") {
+        pro::async_mutex mutex;
+        std::atomic<int> inside = 0;
+        std::atomic<int> peak = 0;
+        int counter = 0;
+
+        std::vector<pro::promise<void>> workers;
+        for (int i = 0; i < 20; ++i) {
+            workers.push_back(mutex.lock().then([&](pro::async_mutex::guard g) {
+                peak = std::max(peak.load(), ++inside);
+                ++counter;
+                --inside;
+            }));
+        }
+        for (auto& w : workers)
+            w.then([] {});
+
+        REQUIRE(counter == 20);
+        CHECK(peak == 1);
+        CHECK_FALSE(mutex.is_locked());
+    }
+
+    SECTION("Semaphore waiters are served in FIFO order") {
+        pro::async_semaphore semaphore(2);
+        std::vector<int> order;
+
+        auto held = semaphore.try_acquire(2);
+        REQUIRE(held.has_value());
+        CHECK_FALSE(semaphore.try_acquire().has_value());
+
+        auto first = semaphore.acquire(2);
+        auto second = semaphore.acquire(1);
+        CHECK(semaphore.waiting() == 2);
+
+        held->release();
+        first.then([&order](pro::async_semaphore::guard g) { order.push_back(1); });
+        second.then([&order](pro::async_semaphore::guard g) { order.push_back(2); });
+
+        REQUIRE(order == std::vector<int>{ 1, 2 });
+        CHECK(semaphore.available() == 2);
+
+        int res = 0;
+        semaphore.acquire(3).then([](pro::async_semaphore::guard g) {}, [](pro::async_semaphore::guard g) {},
+            [&res](std::exception_ptr) { res = 115; });
+        REQUIRE(res == 115);
+    }
+
+    SECTION("Readers share the lock, a writer waits for them") {
+        pro::async_shared_mutex mutex;
+
+        auto reader1 = mutex.try_lock_shared();
+        auto reader2 = mutex.try_lock_shared();
+        REQUIRE(reader1.has_value());
+        REQUIRE(reader2.has_value());
+        CHECK_FALSE(mutex.try_lock().has_value());
+
+        std::atomic<bool> written = false;
+        auto writer = mutex.lock().then([&written](pro::async_shared_mutex::guard g) {
+            written = g.is_exclusive();
+        });
+
+        //a later reader queues behind the writer
+        CHECK_FALSE(mutex.try_lock_shared().has_value());
+
+        reader1->release();
+        CHECK_FALSE(written);
+        reader2->release();
+        writer.then([] {});
+
+        REQUIRE(written);
+        CHECK(mutex.try_lock().has_value());
+    }
+
+    SECTION("A guard nobody takes is released outside the lock") {
+        pro::async_semaphore semaphore(1);
+
+        auto held = semaphore.try_acquire();
+        REQUIRE(held.has_value());
+        {
+            //the guard granted to this waiter is destroyed while the holder releases
+            auto dropped = semaphore.acquire();
+        }
+        held->release();
+
+        CHECK(semaphore.available() == 1);
+        CHECK(semaphore.try_acquire().has_value());
+    }
+}
+TEST_CASE("async_latch", "[util]")
+{
+    SECTION("Waiters are released by the last count down") {
+        pro::async_latch latch(3);
+        std::atomic<int> res = 0;
+
+        auto w1 = latch.wait().then([&res] { ++res; });
+        auto w2 = latch.wait().then([&res] { ++res; });
+
+        latch.count_down();
+        latch.count_down();
+        CHECK_FALSE(latch.try_wait());
+        CHECK(res == 0);
+
+        latch.arrive_and_wait().then([&res] { ++res; });
+        w1.then([] {});
+        w2.then([] {});
+        REQUIRE(res == 3);
+        CHECK(latch.try_wait());
+
+        latch.wait().then([&res] { res += 112; });
+        REQUIRE(res == 115);
+    }
+
+    SECTION("Barrier phases run the completion once per phase") {
+        std::atomic<int> completions = 0;
+        pro::async_barrier barrier(3, [&completions] { ++completions; });
+
+        for (int phase = 0; phase < 3; ++phase) {
+            std::vector<pro::promise<void>> arrivals;
+            for (int i = 0; i < 3; ++i)
+                arrivals.push_back(pro::promise<void>([&barrier] { barrier.arrive().then([] {}); }));
+            for (auto& a : arrivals)
+                a.then([] {});
+        }
+
+        REQUIRE(completions == 3);
+        CHECK(barrier.current_phase() == 3);
+
+        barrier.arrive_and_drop();
+        auto a1 = barrier.arrive();
+        CHECK(barrier.current_phase() == 3);
+        barrier.arrive().then([] {});
+        a1.then([] {});
+        CHECK(barrier.current_phase() == 4);
+    }
+
+    SECTION("The next phase starts after the completion") {
+        std::atomic<bool> completing = false;
+        std::atomic<bool> completed = false;
+        pro::async_barrier barrier(1, [&] {
+            completing = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            completed = true;
+        });
+
+        //the phase is never seen advanced while the completion still runs
+        pro::promise<bool> observer([&] {
+            while (false == completing)
+                std::this_thread::yield();
+            unsigned long long phase = barrier.current_phase();
+            return phase == 0 || completed;
+        });
+        barrier.arrive().then([] {});
+
+        observer.then([](bool ordered) { CHECK(ordered); });
+        CHECK(barrier.current_phase() == 1);
+    }
+
+    SECTION("Manual and auto reset events") {
+        std::atomic<int> res = 0;
+
+        pro::async_event manual;
+        auto m1 = manual.wait().then([&res] { ++res; });
+        auto m2 = manual.wait().then([&res] { ++res; });
+        manual.set();
+        m1.then([] {});
+        m2.then([] {});
+        manual.wait().then([&res] { ++res; });
+        REQUIRE(res == 3);
+        CHECK(manual.is_set());
+        manual.reset();
+        CHECK_FALSE(manual.is_set());
+
+        pro::async_event automatic(false);
+        auto a1 = automatic.wait().then([&res] { res += 10; });
+        auto a2 = automatic.wait().then([&res] { res += 100; });
+        automatic.set();
+        a1.then([] {});
+        CHECK(res == 13);
+        automatic.set();
+        a2.then([] {});
+        REQUIRE(res == 113);
+        CHECK_FALSE(automatic.is_set());
+
+        automatic.set();
+        CHECK(automatic.is_set());
+        automatic.wait().then([&res] { res += 2; });
+        REQUIRE(res == 115);
+        CHECK_FALSE(automatic.is_set());
+    }
+}
+TEST_CASE("async_generator", "[util]")
+{
+    SECTION("Values are produced on demand") {
+        std::atomic<int> produced = 0;
+        pro::async_generator<int> gen([&produced](pro::async_generator<int>::yielder& yield) {
+            for (int i = 1; i <= 3; ++i) {
+                ++produced;
+                yield(i);
+            }
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(produced == 0);
+
+        int res = 0;
+        gen.next().then([&res](std::optional<int> v) { res = *v; });
+        REQUIRE(res == 1);
+        CHECK(produced <= 2);
+
+        gen.for_each([&res](int i) { res = res * 10 + i; }).then([] {});
+        REQUIRE(res == 123);
+
+        bool ended = false;
+        gen.next().then([&ended](std::optional<int> v) { ended = !v.has_value(); });
+        REQUIRE(ended);
+    }
+
+    SECTION("Typed rejections and exceptions end the stream") {
+        int res = 0;
+        pro::async_generator<int> rejecting([](pro::async_generator<int>::yielder& yield) {
+            yield(100);
+            throw 15;
+        });
+
+        rejecting.for_each(
+            [&res](int i) { res += i; },
+            [&res](int i) { res += i; },
+            [&res](std::exception_ptr) { res = -1; }).then([] {});
+        REQUIRE(res == 115);
+
+        bool failed = false;
+        pro::async_generator<int> failing([](pro::async_generator<int>::yielder& yield) {
+            throw std::runtime_error("Error");
+        });
+        failing.for_each([](int) {}).fail([&failed](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (std::runtime_error&) {
+                failed = true;
+            }
+        });
+        REQUIRE(failed);
+    }
+
+    SECTION("Dropping the generator stops the producer") {
+        std::atomic<bool> stopped = false;
+        {
+            pro::async_generator<int> endless([&stopped](pro::async_generator<int>::yielder& yield) {
+                try {
+                    for (int i = 0; ; ++i)
+                        yield(i);
+                }
+                catch (pro::generator_stopped&) {
+                    stopped = true;
+                    throw;
+                }
+            });
+            endless.next().then([](std::optional<int>) {});
+        }
+
+        for (int i = 0; i < 100 && !stopped; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        REQUIRE(stopped);
+    }
+
+    SECTION("A producer can test for the stop instead of catching it") {
+        std::atomic<bool> stopped = false;
+        {
+            pro::async_generator<int> endless([&stopped](pro::async_generator<int>::yielder& yield) {
+                for (int i = 0; false == yield.stop_requested(); ++i) {
+                    try {
+                        yield(i);
+                    }
+                    catch (...) {
+                    }
+                }
+                stopped = true;
+            });
+            endless.next().then([](std::optional<int>) {});
+        }
+
+        for (int i = 0; i < 100 && !stopped; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        REQUIRE(stopped);
+    }
+
+    SECTION("Pending next() calls are served in order by one producer thread") {
+        std::set<std::thread::id> producers;
+        pro::async_generator<int> gen([&producers](pro::async_generator<int>::yielder& yield) {
+            for (int i = 1; i <= 3; ++i) {
+                producers.insert(std::this_thread::get_id());
+                yield(i);
+            }
+        });
+
+        auto first = gen.next();
+        auto second = gen.next();
+        auto third = gen.next();
+        auto end = gen.next();
+
+        int res = 0;
+        first.then([&res](std::optional<int> v) { res = res * 10 + *v; });
+        second.then([&res](std::optional<int> v) { res = res * 10 + *v; });
+        third.then([&res](std::optional<int> v) { res = res * 10 + *v; });
+        end.then([&res](std::optional<int> v) { res += v.has_value() ? 0 : 1000; });
+
+        REQUIRE(res == 1123);
+        CHECK(producers.size() == 1);
+    }
+}
+#ifdef __linux__
+TEST_CASE("io reactor", "[io]")
+{
+    pro::executor ex(2);
+    pro::io::reactor reactor(ex);
+
+    SECTION("Readable and writable promises on a socketpair") {
+        int fds[2];
+        REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+
+        bool writable = false;
+        reactor.writable(fds[0]).then([&writable] { writable = true; });
+        REQUIRE(writable);
+
+        std::atomic<bool> readable = false;
+        auto pending = reactor.readable(fds[1]).then([&readable] { readable = true; });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK_FALSE(readable);
+
+        REQUIRE(::write(fds[0], "x", 1) == 1);
+        pending.then([] {});
+        REQUIRE(readable);
+
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    SECTION("Read waits for data, write returns what was written") {
+        int fds[2];
+        REQUIRE(::pipe2(fds, O_NONBLOCK) == 0);
+
+        char buffer[16] = {};
+        size_t received = 0;
+        auto reading = reactor.read(fds[0], buffer, sizeof(buffer)).then([&received](size_t n) { received = n; });
+
+        size_t sent = 0;
+        reactor.write(fds[1], "promise", 7).then([&sent](size_t n) { sent = n; });
+        reading.then([] {});
+
+        REQUIRE(sent == 7);
+        REQUIRE(received == 7);
+        CHECK(std::string(buffer, received) == "promise");
+
+        ::close(fds[1]);
+        reactor.read(fds[0], buffer, sizeof(buffer)).then([&received](size_t n) { received = n; });
+        REQUIRE(received == 0);
+        ::close(fds[0]);
+    }
+
+    SECTION("Forgetting a descriptor rejects its waiters") {
+        int fds[2];
+        REQUIRE(::pipe2(fds, O_NONBLOCK) == 0);
+
+        int res = 0;
+        auto pending = reactor.readable(fds[0]).fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (std::system_error& e) {
+                res = e.code().value();
+            }
+        });
+        CHECK(reactor.watched() == 1);
+
+        reactor.forget(fds[0]);
+        pending.then([] {});
+        REQUIRE(res == ECANCELED);
+        CHECK(reactor.watched() == 0);
+
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+}
+#endif
+
+#ifdef __linux__
+TEST_CASE("io file", "[io]")
+{
+    std::string path = "/tmp/pro_io_file_" + std::to_string(::getpid());
+    auto preferred = GENERATE(pro::fs::backend::io_uring, pro::fs::backend::thread_pool);
+    pro::fs::file_service files(preferred);
+    if (preferred == pro::fs::backend::thread_pool)
+        REQUIRE(files.get_backend() == pro::fs::backend::thread_pool);
+
+    SECTION("Write and read back at an offset") {
+        std::string text = "js-like promises";
+        size_t written = 0;
+        files.write(path, 0, text.data(), text.size()).then([&written](size_t n) { written = n; });
+        REQUIRE(written == text.size());
+
+        char buffer[8] = {};
+        size_t read = 0;
+        files.read(path, 8, buffer, sizeof(buffer)).then([&read](size_t n) { read = n; });
+        REQUIRE(read == 8);
+        CHECK(std::string(buffer, read) == "promises");
+
+        std::string content;
+        files.read_file(path).then([&content](std::string s) { content = std::move(s); });
+        CHECK(content == text);
+    }
+
+    SECTION("Batched reads on one descriptor") {
+        std::string text(200000, '\0');
+        for (size_t i = 0; i < text.size(); ++i)
+            text[i] = static_cast<char>('a' + i % 26);
+        files.write(path, 0, text.data(), text.size()).then([](size_t) {});
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        REQUIRE(fd >= 0);
+
+        std::vector<char> chunks(4 * 1000);
+        std::vector<pro::promise<size_t>> reads;
+        {
+            pro::fs::batch batch(files);
+            for (size_t i = 0; i < 4; ++i)
+                reads.push_back(files.read(fd, i * 50000, &chunks[i * 1000], 1000));
+        }
+
+        size_t total = 0;
+        for (auto& p : reads)
+            p.then([&total](size_t n) { total += n; });
+        REQUIRE(total == 4000);
+        for (size_t i = 0; i < 4; ++i)
+            CHECK(std::string(&chunks[i * 1000], 1000) == text.substr(i * 50000, 1000));
+
+        std::string content;
+        files.read_file(path).then([&content](std::string s) { content = std::move(s); });
+        CHECK(content == text);
+        ::close(fd);
+    }
+
+    SECTION("Missing files and bad descriptors reject") {
+        int res = 0;
+        auto on_error = [&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (std::system_error& e) {
+                res = e.code().value();
+            }
+        };
+
+        files.read_file(path + ".missing").then([](std::string) {}, [](std::string) {}, on_error);
+        CHECK(res == ENOENT);
+
+        char buffer[4];
+        res = 0;
+        files.read(-1, 0, buffer, sizeof(buffer)).fail(on_error);
+        CHECK(res == EBADF);
+    }
+
+    SECTION("Registered buffers are read into and written from in place") {
+        std::vector<char> block(4096, 'x');
+        files.register_buffers({ iovec{ block.data(), block.size() } });
+
+        size_t written = 0;
+        files.write(path, 0, block.data(), 100).then([&written](size_t n) { written = n; });
+        REQUIRE(written == 100);
+
+        std::fill(block.begin(), block.end(), '\0');
+        size_t read = 0;
+        files.read(path, 0, &block[1000], 100).then([&read](size_t n) { read = n; });
+        REQUIRE(read == 100);
+        CHECK(std::string(&block[1000], 100) == std::string(100, 'x'));
+
+        files.register_buffers({});
+    }
+
+    SECTION("A batch holds back only the submissions to its own service") {
+        std::string text = "unbatched";
+        files.write(path, 0, text.data(), text.size()).then([](size_t) {});
+
+        pro::fs::file_service other(preferred);
+        pro::fs::batch batch(other);
+
+        char buffer[9] = {};
+        std::future<size_t> read = files.read(path, 0, buffer, sizeof(buffer));
+        REQUIRE(read.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        CHECK(read.get() == 9);
+    }
+
+    SECTION("Operations in flight are rejected when the service is gone") {
+        int pipe_fds[2];
+        REQUIRE(::pipe(pipe_fds) == 0);
+
+        char buffer[4];
+        std::future<size_t> pending;
+        {
+            pro::fs::file_service local(preferred);
+            if (local.get_backend() == pro::fs::backend::io_uring)
+                pending = local.read(pipe_fds[0], 0, buffer, sizeof(buffer));
+        }
+
+        if (pending.valid()) {
+            REQUIRE(pending.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+            int res = 0;
+            try {
+                pending.get();
+            }
+            catch (std::system_error& e) {
+                res = e.code().value();
+            }
+            CHECK(res == ECANCELED);
+        }
+        ::close(pipe_fds[0]);
+        ::close(pipe_fds[1]);
+    }
+
+    ::unlink(path.c_str());
+}
+#endif
+
+#ifdef __linux__
+TEST_CASE("io timer queue", "[io]")
+{
+    pro::executor ex(2);
+    pro::io::reactor reactor(ex);
+
+    SECTION("Delay resolves not sooner than asked") {
+        pro::io::timer_queue timers(reactor);
+        auto started = std::chrono::steady_clock::now();
+        bool resolved = false;
+        timers.delay(std::chrono::milliseconds(30)).then([&resolved] { resolved = true; });
+        REQUIRE(resolved);
+        CHECK(std::chrono::steady_clock::now() - started >= std::chrono::milliseconds(30));
+        CHECK(timers.pending() == 0);
+    }
+
+    SECTION("Cancelled delay rejects and frees its timer") {
+        pro::io::timer_queue timers(reactor);
+        pro::io::timer_queue::timer_id id = 0;
+        int res = 0;
+        auto pending = timers.delay(std::chrono::hours(1), id).fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (std::system_error& e) {
+                res = e.code().value();
+            }
+        });
+        CHECK(timers.pending() == 1);
+
+        REQUIRE(timers.cancel(id));
+        pending.then([] {});
+        CHECK(res == ECANCELED);
+        CHECK(timers.pending() == 0);
+        CHECK_FALSE(timers.cancel(id));
+    }
+
+    SECTION("Many pending timers are cheap to schedule and cancel") {
+        pro::io::timer_queue timers(reactor);
+        std::vector<pro::io::timer_queue::timer_id> ids;
+        for (int i = 0; i < 100000; ++i)
+            ids.push_back(timers.schedule(std::chrono::seconds(60 + i), [] {}));
+        CHECK(timers.pending() == 100000);
+
+        for (auto id : ids)
+            REQUIRE(timers.cancel(id));
+        CHECK(timers.pending() == 0);
+    }
+
+    SECTION("Timers across wheel levels fire in deadline order") {
+        //a microsecond tick puts these delays on the higher levels of the wheel
+        pro::io::timer_queue timers(reactor, std::chrono::microseconds(1));
+        std::mutex mutex;
+        std::vector<int> fired;
+        auto started = std::chrono::steady_clock::now();
+        std::vector<bool> early(8, false);
+        pro::async_latch done(8);
+
+        for (int i = 7; i >= 0; --i) {
+            auto after = std::chrono::microseconds(100 + i * 15000);
+            timers.schedule(after, [&, i, after] {
+                std::lock_guard<std::mutex> lock(mutex);
+                early[i] = std::chrono::steady_clock::now() - started < after;
+                fired.push_back(i);
+                done.count_down();
+            });
+        }
+
+        done.wait().then([] {});
+        REQUIRE(fired == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7 });
+        CHECK(std::find(early.begin(), early.end(), true) == early.end());
+    }
+}
+#endif
+
+#ifdef __linux__
+TEST_CASE("io process", "[io]")
+{
+    pro::executor ex(2);
+    pro::io::reactor reactor(ex);
+
+    SECTION("Exit status of a successful program") {
+        pro::process::result result;
+        pro::process::spawn({ "/bin/true" }, {}, reactor).then([&result](pro::process::result r) { result = std::move(r); });
+        CHECK(result.success());
+        CHECK(result.exit_code == 0);
+        CHECK(result.out.empty());
+    }
+
+    SECTION("Captured output and exit code") {
+        pro::process::result result;
+        pro::process::spawn({ "/bin/sh", "-c", "echo out; echo err >&2; exit 3" }, {}, reactor)
+            .then([&result](pro::process::result r) { result = std::move(r); });
+        CHECK_FALSE(result.success());
+        CHECK(result.exit_code == 3);
+        CHECK(result.out == "out\n");
+        CHECK(result.err == "err\n");
+    }
+
+    SECTION("Streamed output, environment and working directory") {
+        pro::process::options opts;
+        opts.working_directory = "/tmp";
+        opts.environment = { "GREETING=hello" };
+        std::mutex mutex;
+        std::string streamed;
+        opts.on_stdout = [&](const std::string& chunk) {
+            std::lock_guard<std::mutex> lock(mutex);
+            streamed += chunk;
+        };
+
+        pro::process::result result;
+        pro::process::spawn({ "/bin/sh", "-c", "echo $GREETING; pwd" }, opts, reactor)
+            .then([&result](pro::process::result r) { result = std::move(r); });
+        CHECK(result.success());
+        CHECK(result.out.empty());
+        CHECK(streamed == "hello\n/tmp\n");
+    }
+
+    SECTION("Killed by a signal") {
+        pro::process::result result;
+        pro::process::spawn({ "/bin/sh", "-c", "kill -9 $$" }, {}, reactor)
+            .then([&result](pro::process::result r) { result = std::move(r); });
+        CHECK(result.signal == SIGKILL);
+        CHECK(result.exit_code == -1);
+    }
+
+    SECTION("Missing program rejects") {
+        int res = 0;
+        pro::process::spawn({ "/nonexistent/program" }, {}, reactor).fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (std::system_error& e) {
+                res = e.code().value();
+            }
+        });
+        CHECK(res == ENOENT);
+    }
+
+    SECTION("Children run concurrently") {
+        auto started = std::chrono::steady_clock::now();
+        std::vector<pro::promise<pro::process::result>> children;
+        for (int i = 0; i < 4; ++i)
+            children.push_back(pro::process::spawn({ "/bin/sh", "-c", "sleep 0.2" }, {}, reactor));
+
+        int succeeded = 0;
+        for (auto& child : children)
+            child.then([&succeeded](pro::process::result r) { succeeded += r.success(); });
+        CHECK(succeeded == 4);
+        CHECK(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(700));
+    }
+
+    SECTION("A child reaped by an ignored SIGCHLD rejects") {
+        auto previous = ::signal(SIGCHLD, SIG_IGN);
+        int res = 0;
+        pro::process::spawn({ "/bin/true" }, {}, reactor).fail([&res](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (std::system_error& e) {
+                res = e.code().value();
+            }
+        });
+        ::signal(SIGCHLD, previous);
+        CHECK((res == ESRCH || res == ECHILD));
+    }
+}
+#endif
+
+#ifdef __linux__
+TEST_CASE("ipc shared promise", "[io]")
+{
+    std::string name = "pro_ipc_test_" + std::to_string(::getpid());
+
+    SECTION("Settled by another process") {
+        auto shared = pro::ipc::shared_promise<IpcPoint>::create(name);
+        auto consumer = shared.get_promise();
+
+        pid_t child = spawnIpcPeer("settle", name);
+        REQUIRE(child > 0);
+
+        IpcPoint received{ 0, 0 };
+        consumer.then([&received](IpcPoint p) { received = p; });
+        CHECK(received.x == 3);
+        CHECK(received.y == 4);
+        CHECK(shared.settled());
+
+        int status = 0;
+        ::waitpid(child, &status, 0);
+        CHECK(WEXITSTATUS(status) == 0);
+    }
+
+    SECTION("Awaited by another process") {
+        auto shared = pro::ipc::shared_promise<int>::create(name);
+
+        pid_t child = spawnIpcPeer("await", name);
+        REQUIRE(child > 0);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        shared.reject(42);
+        CHECK_THROWS_AS(shared.set_value(1), std::future_error);
+
+        int status = 0;
+        ::waitpid(child, &status, 0);
+        CHECK(WEXITSTATUS(status) == 42);
+    }
+
+    SECTION("A settler dying half way rejects the waiters") {
+        auto shared = pro::ipc::shared_promise<int>::create(name);
+
+        //a pid which is gone: a child already waited for
+        pid_t gone = spawnIpcPeer("exit", name);
+        REQUIRE(gone > 0);
+        ::waitpid(gone, nullptr, 0);
+
+        //what a settler leaves behind when it dies right after claiming the state
+        int fd = ::shm_open(("/" + name).c_str(), O_RDWR, 0);
+        REQUIRE(fd >= 0);
+        void* segment = ::mmap(nullptr, sizeof(uint32_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        REQUIRE(segment != MAP_FAILED);
+        static_cast<std::atomic<uint32_t>*>(segment)->store(pro::ipc::detail::_settling | (uint32_t(gone) << pro::ipc::detail::_state_bits));
+        ::munmap(segment, sizeof(uint32_t));
+
+        std::string message;
+        shared.get_promise().fail([&message](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (std::runtime_error& e) {
+                message = e.what();
+            }
+        });
+        CHECK(message == "the process settling the shared promise died");
+        CHECK(shared.settled());
+    }
+
+    SECTION("Exceptions keep their message") {
+        auto shared = pro::ipc::shared_promise<int>::create(name);
+        shared.set_exception("worker failed");
+
+        std::string message;
+        shared.get_promise().fail([&message](std::exception_ptr eptr) {
+            try {
+                std::rethrow_exception(eptr);
+            }
+            catch (std::runtime_error& e) {
+                message = e.what();
+            }
+        });
+        CHECK(message == "worker failed");
+    }
+
+    SECTION("Names are exclusive and removed with their creator") {
+        {
+            auto shared = pro::ipc::shared_promise<int>::create(name);
+            CHECK_THROWS_AS(pro::ipc::shared_promise<int>::create(name), std::system_error);
+        }
+        CHECK_THROWS_AS(pro::ipc::shared_promise<int>::open(name), std::system_error);
+    }
+}
+#endif
+
+#ifdef __linux__
+TEST_CASE("io pollable promises", "[io]")
+{
+    auto readable = [](int fd, int timeout_ms) {
+        pollfd p{ fd, POLLIN, 0 };
+        return ::poll(&p, 1, timeout_ms) == 1;
+    };
+
+    SECTION("Eventfd becomes readable on settlement") {
+        std::promise<int> source;
+        pro::io::pollable<int> pollable(pro::promise<int>(source.get_future()));
+        CHECK_FALSE(readable(pollable.native_handle(), 20));
+        CHECK_FALSE(pollable.ready());
+
+        source.set_value(7);
+        REQUIRE(readable(pollable.native_handle(), 1000));
+        CHECK(pollable.ready());
+
+        int value = 0;
+        pollable.take().then([&value](int v) { value = v; });
+        CHECK(value == 7);
+        CHECK_THROWS_AS(pollable.take(), std::future_error);
+    }
+
+    SECTION("Rejections are kept") {
+        pro::io::pollable<int> pollable(pro::make_promise<int>([]() -> int { throw 13; }));
+        REQUIRE(readable(pollable.native_handle(), 1000));
+
+        int reason = 0;
+        pollable.take().then([](int) {}, [&reason](int r) { reason = r; });
+        CHECK(reason == 13);
+    }
+
+    SECTION("Completion set drains a batch from one eventfd") {
+        pro::io::completion_set set;
+        std::vector<std::promise<int>> sources(3);
+        for (auto& source : sources)
+            set.add(pro::promise<int>(source.get_future()), [](pro::promise<int>) {});
+
+        std::vector<int> values;
+        std::promise<void> ready_void;
+        set.add(pro::promise<void>(ready_void.get_future()), [&values](pro::promise<void> p) { p.then([&values] { values.push_back(-1); }); });
+        CHECK(set.pending() == 4);
+        CHECK_FALSE(readable(set.native_handle(), 20));
+        CHECK(set.drain() == 0);
+
+        std::vector<std::promise<int>> more(2);
+        for (auto& source : more)
+            set.add(pro::promise<int>(source.get_future()), [&values](pro::promise<int> p) { p.then([&values](int v) { values.push_back(v); }); });
+
+        more[0].set_value(10);
+        more[1].set_value(20);
+        ready_void.set_value();
+        while (set.pending() > 3)
+            REQUIRE(readable(set.native_handle(), 1000));
+
+        REQUIRE(readable(set.native_handle(), 0));
+        CHECK(set.drain() == 3);
+        CHECK_FALSE(readable(set.native_handle(), 0));
+        std::sort(values.begin(), values.end());
+        CHECK(values == std::vector<int>{ -1, 10, 20 });
+
+        for (auto& source : sources)
+            source.set_value(0);
+        while (set.pending() > 0)
+            REQUIRE(readable(set.native_handle(), 1000));
+        CHECK(set.drain() == 3);
+    }
+
+    SECTION("Pending promises are polled by one thread, which exits when idle") {
+        auto threads = [] {
+            std::ifstream status("/proc/self/status");
+            std::string line;
+            while (std::getline(status, line))
+                if (line.rfind("Threads:", 0) == 0)
+                    return std::stoi(line.substr(8));
+            return 0;
+        };
+
+        pro::io::completion_set set;
+        std::vector<std::promise<int>> sources(100);
+        int before = threads();
+        for (auto& source : sources)
+            set.add(pro::promise<int>(source.get_future()), [](pro::promise<int>) {});
+        CHECK(threads() <= before + 1);
+
+        for (auto& source : sources)
+            source.set_value(1);
+        size_t drained = 0;
+        while (drained < sources.size()) {
+            REQUIRE(readable(set.native_handle(), 1000));
+            drained += set.drain();
+        }
+        CHECK(set.pending() == 0);
+
+        for (int i = 0; i < 100 && threads() > before; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        CHECK(threads() <= before);
+    }
+}
+#endif